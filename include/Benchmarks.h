@@ -0,0 +1,10 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+// On-device micro-benchmarks, built with -D CLOCK_BENCHMARKS=1
+// Results are printed to Serial once at boot.
+#ifdef CLOCK_BENCHMARKS
+void runBenchmarks();
+#endif
+
+#endif // BENCHMARKS_H
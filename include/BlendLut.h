@@ -0,0 +1,26 @@
+#ifndef BLEND_LUT_H
+#define BLEND_LUT_H
+
+#include <Arduino.h>
+
+// Precomputed alpha blends for fixed (foreground, background) colour pairs.
+// Each registered pair gets a 256 entry table, table[alpha] is the blended
+// colour, in panel order ready to write into a 16 bit sprite.
+class BlendLut {
+public:
+    static const uint8_t MAX_PAIRS = 16;
+
+    const uint16_t* registerPair(uint16_t fg, uint16_t bg);
+    const uint16_t* find(uint16_t fg, uint16_t bg) const;
+    uint8_t size() const { return count; }
+
+    // same result as TFT_eSPI::alphaBlend()
+    static uint16_t blend(uint8_t alpha, uint16_t fg, uint16_t bg);
+
+private:
+    uint32_t keys[MAX_PAIRS];
+    uint16_t tables[MAX_PAIRS][256];
+    uint8_t count = 0;
+};
+
+#endif // BLEND_LUT_H
@@ -0,0 +1,67 @@
+#ifndef CLOCK_DISCIPLINE_H
+#define CLOCK_DISCIPLINE_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <time.h>
+#include <mutex>
+
+// Keeps the system clock on a reference, from offsets measured against it
+// (reference minus system clock). The first offset, and any over STEP_US,
+// steps the clock. Smaller ones are slewed in with adjtime(), so the faces
+// never see the time jump back.
+//
+// The ESP32 clock runs off by tens of ppm. The offsets that still build
+// up, summed over MIN_DRIFT_S or more, are the error of a drift estimate,
+// and tick() slews the drift in between the corrections so the clock
+// doesn't wander off while the next one is minutes away.
+//
+// The reference is NTP, or a clock on the LAN leading the others
+// (-D PEER_SYNC). Only the source followed corrects the clock, the other
+// one's offsets are dropped. The NTP and peer tasks both call in, a mutex
+// keeps them apart.
+class ClockDiscipline {
+public:
+    static const int64_t STEP_US = 128000;         // like ntpd
+    static const uint32_t MIN_DRIFT_S = 30;         // offsets are summed this long for the drift
+    static constexpr float MAX_DRIFT_PPM = 500.0f;
+
+    enum Source : uint8_t { SOURCE_NTP, SOURCE_PEER };
+
+    // false if the clock couldn't be set, or the source isn't followed
+    bool correct(int64_t offset_us, Source source = SOURCE_NTP);
+    // every few seconds, from any task
+    void tick();
+    // At boot, the clock kept running through a reset: it counts as synced,
+    // with the drift it missed in the meantime
+    void resume(int64_t offset_us);
+    void follow(Source source);
+    Source following() const { return source; }
+
+    bool synced() const { return synced_by != 0 || resumed; }
+    bool syncedBy(Source s) const { return synced_by & (1 << s); }
+    bool stepped() const { return last_stepped; }
+    // UTC of the last correction, 0 before
+    time_t lastSync() const { return last_sync; }
+    // ppm the system clock runs slow, negative when fast
+    float drift() const { return drift_ppm; }
+    void setDrift(float ppm);
+
+private:
+    bool step(int64_t offset_us);
+    void slew(int64_t delta_us);
+    void limitDrift(float ppm);
+
+    std::mutex lock;
+    Source source = SOURCE_NTP;
+    uint8_t synced_by = 0;      // bit per source
+    bool resumed = false;
+    bool last_stepped = false;
+    time_t last_sync = 0;
+    float drift_ppm = 0;
+    int64_t drift_from = 0;     // esp_timer time the offsets are summed from, 0 after a source change
+    int64_t drift_sum = 0;      // offsets slewed in since
+    int64_t last_tick = 0;
+};
+
+#endif // CLOCK_DISCIPLINE_H
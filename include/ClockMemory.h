@@ -0,0 +1,41 @@
+#ifndef CLOCK_MEMORY_H
+#define CLOCK_MEMORY_H
+
+#include <Arduino.h>
+#include <time.h>
+#include "ClockDiscipline.h"
+
+// What the clock knows about itself across resets. The system clock keeps
+// counting through a reset or deep sleep, only the drift corrections stop.
+// A record in RTC memory, rewritten by every save(), says since when and
+// with what drift; resume() puts the drift missed since then in at boot,
+// and the faces show the right time before WiFi is even up. NTP only
+// refines it.
+//
+// After the power was off the clock starts at 1970 and waits for NTP, but
+// the drift estimate and the time of the last sync are also kept in NVS.
+// Written when the drift moved, or an hour after a sync, to spare the flash.
+class ClockMemory {
+public:
+    static const time_t MIN_VALID = 1704067200;     // 2024, older is an unset clock
+    static const time_t MAX_GAP_S = 86400;          // longer, the RTC's own drift is worse
+    static const time_t NVS_DRIFT_S = 600;          // drift written at most this often
+    static const time_t NVS_SYNC_S = 3600;
+    static constexpr float NVS_DRIFT_PPM = 0.5f;    // change worth writing
+
+    // at boot, before the faces read the clock: true when it kept its time
+    bool resume(ClockDiscipline* clock);
+    // every few seconds, after the clock's tick()
+    void save(const ClockDiscipline& clock);
+
+    // UTC of the last sync this clock knows of, 0 for none
+    time_t lastSync() const { return last_sync; }
+
+private:
+    time_t last_sync = 0;
+    float nvs_drift = 0;          // what NVS holds
+    time_t nvs_sync = 0;
+    time_t nvs_written = 0;
+};
+
+#endif // CLOCK_MEMORY_H
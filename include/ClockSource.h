@@ -0,0 +1,44 @@
+#ifndef CLOCK_SOURCE_H
+#define CLOCK_SOURCE_H
+
+#include <Arduino.h>
+#include <time.h>
+#include "ClockTime.h"
+
+// Where loop() gets the time it hands to the faces, read once per frame.
+// The system clock normally, a warped one to run the faces through a day
+// in a couple of minutes (-D TIME_WARP=<speed>). It is UTC, a TimeZone
+// turns it into local time.
+class ClockSource {
+public:
+    virtual ~ClockSource() {}
+    // UTC seconds, and microseconds into the second
+    virtual void now(time_t* utc, uint32_t* us) = 0;
+};
+
+// The system clock, as set by NTP
+class SystemClock : public ClockSource {
+public:
+    void now(time_t* utc, uint32_t* us) override;
+};
+
+// Runs <speed> times faster than real time from a given start, midnight
+// and the DST changes come round just like on the system clock.
+class WarpClock : public ClockSource {
+public:
+    WarpClock(float speed) : speed(speed) {}
+    void start(time_t from);
+    void now(time_t* utc, uint32_t* us) override;
+
+    // the simulated time last returned by now()
+    time_t epoch() const { return from + (time_t)(sim_us / US_PER_SEC); }
+
+private:
+    float speed;
+    time_t from = 0;
+    uint32_t last_us = 0;
+    uint64_t real_us = 0;   // real time since start(), micros() wraps
+    uint64_t sim_us = 0;
+};
+
+#endif // CLOCK_SOURCE_H
@@ -0,0 +1,134 @@
+#ifndef CLOCK_SPRITE_H
+#define CLOCK_SPRITE_H
+
+#include <TFT_eSPI.h>
+#include "GlyphIndex.h"
+#include "BlendLut.h"
+#include "PixelHeat.h"
+
+// TFT_eSprite with faster smooth font text. Glyphs are looked up through a
+// GlyphIndex built at loadFont() time instead of scanning the font's unicode
+// table per character, so text cost scales with the string, not the font.
+//
+// With setKnownBackground(true) text is assumed to be drawn on a flat area of
+// the text background colour, glyph edges then come from a precomputed colour
+// ramp instead of being blended per pixel.
+//
+// The anti-aliased primitives the faces use are reimplemented to write the
+// sprite buffer directly. Edge pixels that land on the fillSprite() colour
+// are a single BlendLut lookup when the (colour, fill) pair is registered.
+// Fills and spans go through the word wide kernels in Pixel565.h.
+class ClockSprite : public TFT_eSprite {
+public:
+    explicit ClockSprite(TFT_eSPI* tft) : TFT_eSprite(tft) {}
+    ~ClockSprite() { for (DialSlot& slot : dials) free(slot.pixels); }
+
+    void loadFont(String font_name);
+    void loadFont(const uint8_t array[]);
+    void unloadFont();
+
+    void drawGlyph(uint16_t code) override;
+
+    using TFT_eSprite::textWidth;
+    int16_t textWidth(const char* string);
+
+    using TFT_eSprite::drawString;
+    int16_t drawString(const char* string, int32_t x, int32_t y);
+    using TFT_eSprite::drawNumber;
+    int16_t drawNumber(long n, int32_t x, int32_t y);
+
+    void setKnownBackground(bool known) { known_bg = known; }
+    void setBlendLut(const BlendLut* lut) { blend_lut = lut; }
+
+    void fillSprite(uint32_t color);
+    void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) override;
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) override;
+    void drawWideLine(float ax, float ay, float bx, float by, float wd, uint32_t fg_color, uint32_t bg_color = 0x00FFFFFF);
+    void drawWedgeLine(float ax, float ay, float bx, float by, float ar, float br, uint32_t fg_color, uint32_t bg_color = 0x00FFFFFF);
+    void fillSmoothCircle(int32_t x, int32_t y, int32_t r, uint32_t color, uint32_t bg_color = 0x00FFFFFF);
+
+    // How a face goes to the panel. Faces are opaque unless they say
+    // otherwise: the colour keyed push compares every pixel and splits rows
+    // into runs, so it is only worth it for a face that has transparency.
+    // PUSH_CIRCLE sends only the inscribed circle (about 79% of the pixels),
+    // the corners of a round panel are never seen. That takes a window per
+    // row from the CPU, so with DMA up it sends the whole frame over DMA.
+    enum PushMode { PUSH_OPAQUE, PUSH_KEYED, PUSH_CIRCLE };
+    void setPushMode(PushMode mode, uint16_t transparent = TFT_TRANSPARENT) { push_mode = mode; push_key = transparent; }
+    PushMode pushMode() const { return push_mode; }
+    void push(int32_t x, int32_t y);
+
+    // Send the sprite to the panel as it is stored, it is already in panel
+    // order so nothing is swapped or copied. With TFT_eSPI DMA set up and the
+    // sprite in DMA capable RAM the SPI peripheral reads it straight from
+    // sprite memory, otherwise it goes out through pushSprite().
+    void pushPanel(int32_t x, int32_t y);
+    void pushCircle(int32_t x, int32_t y);
+    // TFT_eSPI DMA is up and the sprite can be read by it
+    bool dmaReady() const;
+
+    // Dial cache: a copy of the sprite taken once the static parts of a face
+    // are drawn, copied back at the start of each frame instead of redrawing
+    // them. key is whatever the face's static parts depend on. Panels on one
+    // bus share the sprite, so there is a slot per key. Slots are never
+    // evicted: keys are fixed per panel, and swapping them every frame would
+    // cost a copy on top of each redraw. A key that gets no slot is simply
+    // redrawn. Past the first slot they only go to PSRAM.
+    static const uint8_t DIAL_SLOTS = 4;
+    bool saveDial(uint32_t key);
+    bool restoreDial(uint32_t key);
+
+    void clearDial();
+
+    const GlyphIndex& glyphIndex() const { return glyph_index; }
+
+#ifdef PIXEL_HEATMAP
+    // count pixel writes and blends into heat, nullptr to stop
+    void setHeatmap(PixelHeat* heat) { this->heat = heat; }
+#endif
+
+private:
+    static const uint8_t TEXT_RAMP_SHIFT = 3;
+    static const uint16_t TEXT_RAMP_STEPS = 256 >> TEXT_RAMP_SHIFT;   // 32 steps
+
+    void blendGlyphRow(const uint8_t* alpha, uint8_t w, int32_t cx, int32_t y, uint16_t fg, uint16_t bg);
+    void storeGlyphRow(const uint8_t* alpha, uint8_t w, int32_t cx, int32_t y);
+    void updateTextRamp();
+
+    bool circleSpan(int32_t row, int32_t* x0, int32_t* x1) const;
+#ifdef SPI_TRACE
+    void tracePush(int32_t x, int32_t y);
+#endif
+
+    struct Paint;
+    Paint makePaint(uint32_t fg_color, uint32_t bg_color) const;
+    void plotEdge(int32_t x, int32_t y, uint8_t alpha, const Paint& paint);
+
+    GlyphIndex glyph_index;
+
+    bool known_bg = false;
+    uint32_t ramp_fg = 0xFFFFFFFF;   // colours the ramp was built for
+    uint32_t ramp_bg = 0xFFFFFFFF;
+    uint16_t text_ramp[TEXT_RAMP_STEPS];
+    uint16_t text_solid;
+
+    const BlendLut* blend_lut = nullptr;
+    uint16_t fill_color = TFT_BLACK;   // last fillSprite() colour
+
+    PushMode push_mode = PUSH_OPAQUE;
+    uint16_t push_key = TFT_TRANSPARENT;
+
+    struct DialSlot {
+        uint16_t* pixels = nullptr;
+        bool valid = false;
+        uint32_t key = 0;
+        uint16_t fill = TFT_BLACK;
+    };
+    DialSlot dials[DIAL_SLOTS];
+
+#ifdef PIXEL_HEATMAP
+    PixelHeat* heat = nullptr;
+#endif
+};
+
+#endif // CLOCK_SPRITE_H
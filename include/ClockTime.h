@@ -0,0 +1,31 @@
+#ifndef CLOCK_TIME_H
+#define CLOCK_TIME_H
+
+#include <stdint.h>
+
+// Time of day in microseconds, from the clock source through to every
+// face. A float of seconds only has 1/128 s left at the end of the day,
+// this keeps the hands moving smoothly at any frame rate.
+typedef int64_t day_us_t;
+
+#define US_PER_SEC  1000000LL
+#define US_PER_MIN  (60 * US_PER_SEC)
+#define US_PER_HOUR (60 * US_PER_MIN)
+#define US_PER_DAY  (24 * US_PER_HOUR)
+
+// Angles as a fraction of a turn, 2^32 is all the way round. Clockwise
+// from 12 o'clock, and wrapping around is free.
+typedef uint32_t turn_t;
+
+// n/d of a turn, e.g. TURN(3, 12) is where the 3 goes on the dial
+#define TURN(n, d) ((turn_t)(((uint64_t)(n) << 32) / (d)))
+
+// how far round a hand going round once every period is at time t
+turn_t handTurn(day_us_t t, int64_t period);
+
+// sine and cosine of a turn, scaled to +-32767 (Q15), from a quarter wave
+// table with linear interpolation, good to well under a pixel at r=120
+int16_t sinTurn(turn_t a);
+inline int16_t cosTurn(turn_t a) { return sinTurn(a + 0x40000000); }
+
+#endif // CLOCK_TIME_H
@@ -0,0 +1,11 @@
+#ifndef CORES_H
+#define CORES_H
+
+#include <Arduino.h>
+
+// The core loop() isn't running on. loop() keeps its own core for drawing,
+// the tasks that push, sync the clock and talk to the network go on this
+// one. Call it from the loop's task.
+inline BaseType_t otherCore() { return xPortGetCoreID() ? 0 : 1; }
+
+#endif // CORES_H
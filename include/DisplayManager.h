@@ -0,0 +1,82 @@
+#ifndef DISPLAY_MANAGER_H
+#define DISPLAY_MANAGER_H
+
+#include <Arduino.h>
+
+// One round panel on an SPI bus, selected by its own CS pin
+struct Panel {
+    uint8_t cs_pin;
+    uint8_t face;          // which face the sketch renders for it
+    uint16_t bg_color;
+    bool mirrored;         // same content as other mirrored panels with this face and background
+    int16_t canvas_x;      // position on a spanning canvas, for faces drawn across panels
+    int16_t canvas_y;
+    uint8_t bus;           // 0: TFT_eSPI's bus, 1: the second SPI host (see PanelBus)
+    const char* tz;        // POSIX TZ string for this panel, nullptr for the clock's own
+};
+
+// Panels that are rendered and pushed together: a single panel, or all the
+// mirrored panels showing the same face on the same background (and the
+// same slice of a spanning canvas, in the same timezone) on one bus
+struct PanelGroup {
+    uint32_t mask;         // bit per panel index
+    uint8_t first;         // panel whose settings the group uses
+    uint8_t bus;
+};
+
+class DisplayManager {
+public:
+    static const uint8_t MAX_PANELS = 32;
+    static const uint8_t MAX_BUSES = 2;
+
+    DisplayManager(const Panel* panels, uint8_t count);
+    void begin();
+
+    // Each bus keeps its own selection, so buses can be driven from
+    // different tasks at the same time
+    void select(uint32_t mask, uint8_t bus = 0);
+    void selectAll(uint8_t bus = 0) { select(bus_mask[bus], bus); }
+    void release(uint8_t bus = 0) { select(0, bus); }
+    uint32_t busMask(uint8_t bus) const { return bus_mask[bus]; }
+
+    // Broadcast: a group is pushed once with all its CS lines low. Turned
+    // off, mirrored panels still share a render but get a push each.
+    void setBroadcast(bool on) { broadcast_on = on; }
+    bool broadcast() const { return broadcast_on; }
+
+    uint8_t groupCount() const { return group_count; }
+    const PanelGroup& group(uint8_t i) const { return groups[i]; }
+    const Panel& panel(uint8_t i) const { return panels[i]; }
+    uint8_t panelCount() const { return count; }
+
+    // Calls push() with the group's panels selected, once for all of them
+    // in broadcast mode or once per panel otherwise
+    template <typename F>
+    void pushGroup(const PanelGroup& group, F push) {
+        if (broadcast_on) {
+            select(group.mask, group.bus);
+            push();
+        } else {
+            for (uint8_t i = 0; i < count; i++) {
+                if (!(group.mask & (1UL << i))) continue;
+                select(1UL << i, group.bus);
+                push();
+            }
+        }
+        release(group.bus);
+    }
+
+private:
+    void buildGroups();
+
+    const Panel* panels;
+    uint8_t count;
+    uint32_t bus_mask[MAX_BUSES] = {};
+    uint32_t selected[MAX_BUSES] = {};
+    bool broadcast_on = true;
+
+    PanelGroup groups[MAX_PANELS];
+    uint8_t group_count = 0;
+};
+
+#endif // DISPLAY_MANAGER_H
@@ -0,0 +1,54 @@
+#ifndef FACES_H
+#define FACES_H
+
+// The analog and digital faces, drawn into a sprite for a time of day.
+// They only draw, the loop decides which panels get them and pushes them.
+// The golden frame checks draw them too, on the board and on the host.
+#include "ClockSprite.h"
+#include "ClockTime.h"
+
+#define CLOCK_X_POS 118
+#define CLOCK_Y_POS 118
+
+#define CLOCK_FG   TFT_LIGHTGREY
+#define CLOCK_BG   TFT_BROWN
+#define SECCOND_FG TFT_YELLOW
+#define LABEL_FG   TFT_RED
+
+#define CLOCK_R       240.0f / 2.0f // Clock face radius (float type)
+#define H_HAND_LENGTH CLOCK_R/2.2f
+#define M_HAND_LENGTH CLOCK_R/1.5f
+#define S_HAND_LENGTH CLOCK_R/1.2f
+
+// How long each hand takes to go round. The angles come from the time in
+// microseconds, so all hands move smoothly, sub-pixel steps included
+#define SECOND_PERIOD US_PER_MIN
+#define MINUTE_PERIOD US_PER_HOUR
+#define HOUR_PERIOD   (12 * US_PER_HOUR)
+
+// Screen width and height
+#define SCREEN_W 240
+#define SCREEN_H 240
+
+// where the digit sprites go on the panel
+#define HOURS_X    2
+#define MINUTES_X  (int16_t)(SCREEN_W/1.8)
+#define DIGITS_Y   (SCREEN_H/2 - SCREEN_H/4)
+
+// Every colour the analog face anti-aliases, blends over each background
+// are precomputed once in setupDisplays()
+static const uint16_t aa_colors[] = {CLOCK_FG, SECCOND_FG, TFT_GREEN, TFT_GREENYELLOW};
+
+void getCoord(int16_t x, int16_t y, float *xp, float *yp, int16_t r, turn_t a);
+
+// The whole analog face for time of day t, the dial comes from the
+// sprite's dial cache once it has been drawn on bg_color
+void drawAnalogFace(ClockSprite& face, day_us_t t, uint16_t bg_color);
+
+// The digital face is two sprites, SCREEN_W/2 x SCREEN_H/2 with the
+// Mali-Bold-90 and Mali-Bold-60 fonts: the hours, and the minutes over
+// the seconds
+void drawDigitalHours(ClockSprite& hours, int hr, uint16_t bg_color);
+void drawDigitalMinutes(ClockSprite& minutes, day_us_t t, uint16_t bg_color);
+
+#endif // FACES_H
@@ -0,0 +1,45 @@
+#ifndef GLYPH_INDEX_H
+#define GLYPH_INDEX_H
+
+#include <Arduino.h>
+#include <vector>
+
+// Maps a unicode code point to its glyph number in a loaded smooth font.
+// TFT_eSPI scans the font's whole unicode table for every character drawn,
+// this builds a direct table for ASCII and a sorted table for everything
+// else once, when the font is loaded.
+class GlyphIndex {
+public:
+    GlyphIndex() { clear(); }
+
+    void build(const uint16_t* unicode, uint16_t count);
+    void clear();
+
+    inline bool find(uint16_t code, uint16_t* index) const {
+        if (code < ASCII_SIZE) {
+            if (ascii[code] == NO_GLYPH) return false;
+            *index = ascii[code];
+            return true;
+        }
+        return findOther(code, index);
+    }
+
+    uint16_t size() const { return count; }
+
+private:
+    static const uint16_t ASCII_SIZE = 128;
+    static const uint16_t NO_GLYPH = 0xFFFF;
+
+    struct Entry {
+        uint16_t code;
+        uint16_t index;
+    };
+
+    bool findOther(uint16_t code, uint16_t* index) const;
+
+    uint16_t ascii[ASCII_SIZE];
+    std::vector<Entry> others;   // sorted by code, binary searched
+    uint16_t count = 0;
+};
+
+#endif // GLYPH_INDEX_H
@@ -0,0 +1,28 @@
+#ifndef GOLDEN_FRAMES_H
+#define GOLDEN_FRAMES_H
+
+// Both faces drawn at fixed times of day into a software framebuffer (a
+// face sized sprite) for the golden frame checks. A -D GOLDEN_FRAMES build
+// dumps them to Serial for tools/golden_frames.py, the host test
+// (pio test -e native) draws them on the PC. Both compare against the
+// frames stored in test/test_faces/golden.bin.
+//
+// A frame is "\nGOLDEN <face>-<time> <width> <height> <bytes>\n", then
+// runs of (u16 length, u16 colour), little endian, colours in panel order.
+#include "Faces.h"
+
+struct GoldenTime { const char* name; day_us_t t; };
+extern const GoldenTime golden_times[];
+extern const uint8_t GOLDEN_TIMES;
+
+enum GoldenFace : uint8_t { GOLDEN_ANALOG, GOLDEN_DIGITAL, GOLDEN_FACES };
+const char* goldenFaceName(GoldenFace face);
+
+// Fixed backgrounds so the images don't depend on the panel table. The
+// digital face is drawn as a panel shows it: the round background and
+// both digit sprites copied in
+void drawGoldenFrame(ClockSprite& fb, ClockSprite& hours, ClockSprite& minutes, GoldenFace face, day_us_t t);
+
+void dumpFrame(Print& out, const char* face, const char* name, ClockSprite& fb);
+
+#endif // GOLDEN_FRAMES_H
@@ -0,0 +1,96 @@
+#ifndef NTP_CLIENT_H
+#define NTP_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <atomic>
+#include <mutex>
+#include "ClockDiscipline.h"
+
+// SNTP client that asks several servers, in place of the one server LWIP
+// SNTP of configTime(). Until a poll has been answered it sends BURST
+// requests to every server, a second apart, and keeps per server the reply
+// with the shortest round trip: queueing on the way is what skews an
+// offset, the fastest reply has the least of it. After that a poll is one
+// request per server, as the public pools ask, the drift estimate carries
+// the clock between them.
+//
+// A kiss-o'-death reply drops the server for the rest of the poll, and it
+// sits out polls after it: RATE doubles the number each time, up to
+// MAX_BACKOFF, answers halve it again. DENY and RSTR go straight there.
+//
+// A server whose offset is further from the median than half its round
+// trip (plus a little) is a false ticker and left out. The rest are
+// averaged weighted by 1/delay², and the ClockDiscipline steps or slews
+// the clock to the result. While it follows a clock on the LAN instead
+// (-D PEER_SYNC) the result is dropped and sync() returns false.
+//
+// Servers are "host" or "host:port", tools/ntp_standin.py answers on LAN
+// ports with offsets and delays of its own for testing.
+class NtpClient {
+public:
+    static const uint8_t MAX_SERVERS = 4;
+    static const uint8_t BURST = 4;            // requests per server until one poll is answered
+    static const uint8_t MAX_BACKOFF = 64;     // polls a kissing server sits out at most
+    static const uint32_t TIMEOUT_MS = 500;    // per request
+    static const uint32_t SPIN_MS = 20;        // then the wait sleeps a tick at a time
+    static const uint32_t MARGIN_US = 2000;    // beyond half the round trip, for false tickers
+
+    struct Stats {
+        int64_t offset_us;    // combined offset, applied
+        uint32_t jitter_us;   // rms of the servers used around it
+        uint32_t delay_us;    // shortest round trip of them
+        uint8_t used;         // servers in the result
+        uint8_t answered;     // servers that replied at all
+        uint8_t backed_off;   // servers sitting out after a kiss-o'-death
+        bool stepped;         // stepped, or slewed
+        float drift_ppm;      // estimate after it
+    };
+
+    NtpClient(const char* const* servers, uint8_t count, ClockDiscipline* clock);
+
+    // one poll of all the servers and the clock correction, blocks for
+    // BURST seconds or so the first time
+    bool sync();
+    // sync() every poll_s seconds in a task of its own
+    bool start(uint32_t poll_s);
+
+    // a copy of the result of the last sync() that set the clock, the sync
+    // task may be writing it, read it when syncs() changes
+    Stats stats() const;
+    uint32_t syncs() const { return sync_count.load(); }
+    void printStats() const;
+
+private:
+    struct Server {
+        char host[48];
+        uint16_t port;
+        IPAddress ip;
+        bool answered;
+        int64_t offset_us;    // of the fastest reply
+        int64_t delay_us;
+        uint8_t backoff;      // polls to sit out at the next kiss-o'-death
+        uint8_t skip;         // polls left to sit out
+    };
+
+    enum Reply { REPLY_NONE, REPLY_TIME, REPLY_RATE, REPLY_DENY };
+    Reply request(Server& server);
+    static void kissed(Server& server, Reply reply);
+    bool combine(Stats* out);
+    static void taskMain(void* arg);
+
+    Server servers[MAX_SERVERS];
+    uint8_t count = 0;
+    ClockDiscipline* clock;
+    WiFiUDP udp;
+    bool udp_open = false;
+    uint32_t poll_s = 0;
+    bool settled = false;         // a poll was answered, no more bursts
+    uint32_t last_round_ms = 0;   // requests went out
+    Stats last = {};
+    mutable std::mutex last_lock;
+    std::atomic<uint32_t> sync_count{0};
+};
+
+#endif // NTP_CLIENT_H
@@ -0,0 +1,122 @@
+#ifndef PANEL_BUS_H
+#define PANEL_BUS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "DisplayManager.h"
+#include "ClockSprite.h"
+
+#if __has_include(<driver/spi_master.h>)
+#include <driver/spi_master.h>
+#endif
+
+// An SPI bus with panels on it and a push task of its own. Renders hand
+// sprites over with submit() and carry on, the task sends them while the
+// next group is drawn. With panels spread over two buses, both buses are
+// busy at the same time.
+//
+// A sprite must not be drawn into again until the pushes that use it are
+// done, wait() blocks until the bus has sent everything submitted to it.
+// A task that only needs its own pushes done (and shouldn't wait for the
+// loop's) passes a counter to submit(), it goes down as each one is sent.
+
+// How long a group's frames take from reading the clock to the end of their
+// push, as a moving average. begin() before the frame is submitted, the
+// push task adds the sample once it is sent. One frame of a group in flight
+// at a time, the loop waits for the bus before drawing the next.
+class PushLatency {
+public:
+    static const uint32_t MAX_US = 100000;   // stalls (Serial dumps, NTP) don't count
+
+    void begin(uint32_t read_us) { read_at = read_us; }
+    void sent();
+    uint32_t average() const { return avg.load(); }
+
+private:
+    uint32_t read_at = 0;
+    std::atomic<uint32_t> avg{0};
+};
+
+class PanelBus {
+public:
+    struct Job {
+        ClockSprite* sprite;
+        int16_t x, y;
+        PanelGroup group;
+        std::atomic<int>* done;
+        PushLatency* latency;
+    };
+
+    virtual ~PanelBus() {}
+
+    // starts the push task, pinned to the core the loop doesn't use
+    bool start(DisplayManager* displays, const char* name);
+    bool started() const { return queue != nullptr; }
+
+    // first puts the push ahead of those already waiting, for updates that
+    // have to land on time
+    void submit(ClockSprite* sprite, int16_t x, int16_t y, const PanelGroup& group,
+                std::atomic<int>* done = nullptr, bool first = false);
+    // a frame whose latency is measured
+    void submitFrame(ClockSprite* sprite, int16_t x, int16_t y, const PanelGroup& group,
+                     PushLatency* latency);
+    void wait();
+
+protected:
+    virtual void push(const Job& job) = 0;
+    DisplayManager* displays = nullptr;
+
+private:
+    static void taskMain(void* arg);
+    void send(const Job& job, bool first);
+
+    QueueHandle_t queue = nullptr;
+    TaskHandle_t waiter = nullptr;
+    std::atomic<int> pending{0};
+};
+
+// The bus TFT_eSPI drives (VSPI with the pins in platformio.ini). Sprites
+// go out through ClockSprite::push(), so the push modes and DMA apply.
+class TftPanelBus : public PanelBus {
+protected:
+    void push(const Job& job) override;
+};
+
+#if __has_include(<driver/spi_master.h>)
+// A second SPI host driven with the IDF spi_master driver and its own DMA
+// channel. TFT_eSPI only knows one bus, so the GC9A01 init and the address
+// window are done here. CS pins are still handled by DisplayManager, DC is
+// set per transaction.
+//
+// Sprites are always sent as their full rectangle over DMA, the push mode
+// is not used: PUSH_CIRCLE only pays off when the CPU feeds the bus, like
+// ClockSprite::pushCircle() with DMA up. Sprites in PSRAM are
+// copied through two small DMA buffers, one is filled while the other is on
+// the wire.
+class SpiPanelBus : public PanelBus {
+public:
+    static const uint32_t CHUNK_BYTES = 8192;
+
+    bool begin(DisplayManager* displays, uint8_t bus, spi_host_device_t host,
+               int mosi, int sclk, int dc, int rst, uint32_t freq);
+
+protected:
+    void push(const Job& job) override;
+
+private:
+    void command(uint8_t cmd, const uint8_t* data = nullptr, uint8_t len = 0);
+    void setWindow(int16_t x, int16_t y, int16_t w, int16_t h);
+    void sendPixels(const uint16_t* pixels, uint32_t count);
+    void fillPixels(uint16_t color, uint32_t count);
+    void initPanels();
+
+    spi_device_handle_t device = nullptr;
+    uint8_t bus = 1;
+    int dc_pin = -1;
+    int rst_pin = -1;
+    uint8_t* bounce[2] = {nullptr, nullptr};
+    spi_transaction_t trans[2];
+};
+#endif
+
+#endif // PANEL_BUS_H
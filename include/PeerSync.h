@@ -0,0 +1,114 @@
+#ifndef PEER_SYNC_H
+#define PEER_SYNC_H
+
+// Keeps the clocks on a LAN on one of them, built with -D PEER_SYNC=<port>.
+// Clocks each synced to a pool on their own are tens of milliseconds apart,
+// enough to see the second hands of a wall of them out of step.
+//
+// Every clock multicasts a beacon a second to PEER_GROUP:<port> with its
+// id and rank: 0 once NTP has set it, 1 before. The lowest rank, then the
+// lowest id, of the clocks heard from lately leads and keeps following
+// NTP. The others ask it for the time like an NTP client would, BURST
+// requests every POLL_MS, and their ClockDiscipline follows the fastest
+// reply instead of NTP. If the leader goes quiet the next one takes over.
+//
+// Packets, little endian: "CLKP", u8 type, u8 rank, u16 port the sender
+// takes requests on, u32 id, then i64 t1, t2, t3 in microseconds since
+// 1970: request sent, received and reply sent, as in NTP. Plain sockets,
+// lwIP has them on the board. test/test_peer_sync runs several of these
+// over loopback on the host (pio test -e native).
+#ifdef PEER_SYNC
+#include <Arduino.h>
+#include <atomic>
+#include <mutex>
+#include "ClockDiscipline.h"
+
+#define PEER_GROUP "239.255.12.34"
+
+class PeerSync {
+public:
+    static const uint8_t MAX_PEERS = 8;
+    static const uint32_t BEACON_MS = 1000;
+    static const uint32_t LOST_MS = 3500;     // no beacon for this long, gone
+    static const uint32_t POLL_MS = 4000;     // followers measure the leader this often
+    static const uint8_t BURST = 4;           // requests per measurement, the fastest counts
+    static const uint32_t TIMEOUT_MS = 100;   // per request
+
+    struct Stats {
+        uint32_t leader;      // id, ours when leading
+        int64_t offset_us;    // last measurement of the leader, applied
+        uint32_t delay_us;
+        uint8_t peers;        // heard from lately
+    };
+
+    explicit PeerSync(ClockDiscipline* clock) : clock(clock) {}
+
+    // id has to be unique on the LAN. iface is the address multicast goes
+    // out on (network order), 0 for the only one there is on the board
+    bool begin(uint32_t id, uint32_t iface = 0);
+    // service() in a task of its own, forever
+    bool start();
+    // one pass: beacon and measure the leader when due, then handle what
+    // arrives for up to wait_ms
+    void service(uint32_t wait_ms);
+
+    bool leading() const { return stats().leader == id; }
+    // Goes up with each measurement and leader change, read the stats
+    // when it does
+    uint32_t changes() const { return change_count.load(); }
+    // a copy, the peer task writes them
+    Stats stats() const;
+    void printStats() const;
+
+private:
+    enum Type : uint8_t { BEACON = 1, REQUEST, REPLY };
+
+    struct __attribute__((packed)) Packet {
+        char magic[4];
+        uint8_t type;
+        uint8_t rank;
+        uint16_t port;
+        uint32_t id;
+        int64_t t1, t2, t3;
+    };
+
+    struct Peer {
+        uint32_t id;
+        uint32_t ip;          // network order
+        uint16_t port;
+        uint8_t rank;
+        uint32_t seen_ms;
+    };
+
+    uint8_t rank() const;
+    void send(Packet& packet, uint32_t ip, uint16_t port);
+    void heard(const Packet& packet, uint32_t ip);
+    void chooseLeader();
+    void measure();
+    bool receive(uint32_t wait_ms);
+    void handle(int fd);
+
+    ClockDiscipline* clock;
+    uint32_t id = 0;
+    int group_fd = -1;        // beacons, on the shared port
+    int fd = -1;              // requests and replies, on a port of our own
+    uint16_t port = 0;
+    Peer peers[MAX_PEERS];
+    uint8_t peer_count = 0;
+    Peer leader = {};         // us when leading
+    uint32_t last_beacon = 0;
+    uint32_t last_poll = 0;
+
+    // the measurement going on
+    int64_t pending_t1 = 0;
+    bool answered = false;
+    int64_t best_offset = 0;
+    int64_t best_delay = 0;
+
+    Stats last = {};
+    mutable std::mutex last_lock;
+    std::atomic<uint32_t> change_count{0};
+};
+#endif
+
+#endif // PEER_SYNC_H
@@ -0,0 +1,21 @@
+#ifndef PIXEL565_H
+#define PIXEL565_H
+
+#include <Arduino.h>
+
+// Word wide RGB565 kernels. The ESP32 has no SIMD, but moving two 16 bit
+// pixels per 32 bit load/store halves the memory operations.
+//
+// Pixels are kept in panel order: the GC9A01 takes RGB565 big endian, so
+// 16 bit sprites store every pixel byte swapped and can be sent to the
+// panel untouched. Colours are converted once with panelOrder() when they
+// are set up, the kernels take them already converted.
+
+inline uint16_t panelOrder(uint16_t color) {
+    return (color >> 8) | (color << 8);
+}
+
+void fill565(uint16_t* dst, uint16_t color, uint32_t count);
+void copy565(uint16_t* dst, const uint16_t* src, uint32_t count);
+
+#endif // PIXEL565_H
@@ -0,0 +1,59 @@
+#ifndef PIXEL_HEAT_H
+#define PIXEL_HEAT_H
+
+#include <Arduino.h>
+
+// Per pixel cost counters for a sprite, built with -D PIXEL_HEATMAP.
+// ClockSprite counts every store into the buffer (fills, spans, solid line
+// pixels, text) and every blend (edge pixels mixed with what is under them,
+// by lookup table or arithmetic), per pixel and per primitive call.
+// dump() sends a frame's counts to Serial (or a file on the host) for
+// tools/heatmap.py.
+#ifdef PIXEL_HEATMAP
+class PixelHeat {
+public:
+    enum Primitive : uint8_t { FILL, DIAL, TEXT, LINE, CIRCLE, OTHER, PRIMITIVES };
+
+    // The outermost primitive gets the counts, a wide line drawing through
+    // the wedge line code is still one line
+    class Scope {
+    public:
+        Scope(PixelHeat* heat, Primitive p) : heat(heat) { if (heat) heat->enter(p); }
+        ~Scope() { if (heat) heat->leave(); }
+    private:
+        PixelHeat* heat;
+    };
+
+    ~PixelHeat() { free(writes); }
+    bool begin(uint16_t width, uint16_t height);
+    void reset();
+
+    // count pixels from x,y on, running on into the next rows
+    void write(int32_t x, int32_t y, int32_t count = 1);
+    void blend(int32_t x, int32_t y);
+
+    uint8_t writesAt(int32_t x, int32_t y) const { return writes[y * w + x]; }
+    uint8_t blendsAt(int32_t x, int32_t y) const { return blends[y * w + x]; }
+    uint32_t calls(Primitive p) const { return call_count[p]; }
+    uint32_t writeTotal(Primitive p) const { return write_total[p]; }
+    uint32_t blendTotal(Primitive p) const { return blend_total[p]; }
+
+    void dump(Print& out, const char* name);
+
+private:
+    void enter(Primitive p);
+    void leave() { if (depth) depth--; }
+    void bump(uint8_t* plane, uint32_t i) { if (plane[i] != 0xFF) plane[i]++; }
+
+    uint16_t w = 0, h = 0;
+    uint8_t* writes = nullptr;    // w * h write counts, then w * h blend counts
+    uint8_t* blends = nullptr;
+    Primitive current = OTHER;
+    uint8_t depth = 0;
+    uint32_t call_count[PRIMITIVES];
+    uint32_t write_total[PRIMITIVES];
+    uint32_t blend_total[PRIMITIVES];
+};
+#endif
+
+#endif // PIXEL_HEAT_H
@@ -0,0 +1,117 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#include <chrono>
+#endif
+#include "Timeline.h"
+
+// Timing zones for the render loop, built with -D PROFILER=<seconds>.
+// PROFILE_ZONE(zone) times the rest of the enclosing block with the CPU
+// cycle counter (std::chrono off the board) and adds it to the zone: a
+// ring of the last SAMPLES times for percentiles, and a histogram of all
+// of them in power of two microsecond buckets. Every <seconds> the loop
+// prints a table per zone to Serial.
+//
+// Each zone has one writer (the loop task, or the push task of its bus),
+// so recording takes no lock. The report reads while the push tasks write,
+// a sample may land between two numbers of the same line. Cycle counts
+// are per core, a zone must not move cores, the tasks are pinned.
+//
+// With -D TIMELINE the zones are also begin/end events on the timeline,
+// next to the instant events after ZONES. Without either flag the zones
+// compile to nothing.
+#if defined(PROFILER) || defined(TIMELINE)
+enum ProfileZone : uint8_t {
+    ZONE_FRAME,     // one pass of the loop that draws
+    ZONE_TIME,      // reading the clock source, UTC and microseconds
+    ZONE_WAIT,      // loop waiting for a bus to finish with a sprite
+    ZONE_ANALOG,    // a render, from its sprite being free to the submit
+    ZONE_DIGITAL,
+    ZONE_SPAN,
+    ZONE_PUSH0,     // a push on bus 0, bus 1 follows
+    ZONE_PUSH1,
+    ZONE_SERIAL,    // status output from the loop
+    ZONE_NTP,       // waiting for the first NTP time at boot
+    ZONES,
+    EVENT_SELECT0 = ZONES,  // CS change on bus 0, with the panel mask
+    EVENT_SELECT1,
+    EVENT_NTP_SYNC,         // NTP set the clock, with the servers used
+    EVENTS
+};
+
+extern const char* const profile_names[EVENTS];
+#endif
+
+#ifdef PROFILER
+class Profiler {
+public:
+    static const uint8_t SAMPLES = 64;
+    static const uint8_t BUCKETS = 16;  // <1us, <2us, <4us ... 16ms and up
+
+    class Scope {
+    public:
+        Scope(uint8_t zone) : zone(zone), start(now()) {}
+        inline ~Scope();
+    private:
+        uint8_t zone;
+        uint32_t start;
+    };
+
+    // cycles on the board, ns elsewhere; wraps, only differences count
+    static inline uint32_t now();
+    static uint32_t ticksPerUs();
+
+    void record(uint8_t zone, uint32_t ticks);
+    void tick();        // from loop(), reports every PROFILER seconds
+    void report();
+
+private:
+    struct Zone {
+        uint32_t samples[SAMPLES];
+        uint32_t buckets[BUCKETS];
+        uint32_t count;
+        uint32_t max;
+        uint64_t total;
+    };
+
+    Zone zones[ZONES] = {};
+    uint32_t last_report = 0;
+};
+
+extern Profiler profiler;
+
+inline Profiler::Scope::~Scope() { profiler.record(zone, now() - start); }
+
+#ifdef ARDUINO
+inline uint32_t Profiler::now() { return ESP.getCycleCount(); }
+#else
+inline uint32_t Profiler::now() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+#define PROFILE_STATS(zone)   Profiler::Scope PROFILE_CONCAT(profile_scope_, __LINE__)(zone);
+#else
+#define PROFILE_STATS(zone)
+#endif
+
+#ifdef TIMELINE
+#define PROFILE_EVENTS(zone)  Timeline::Scope PROFILE_CONCAT(timeline_scope_, __LINE__)(zone);
+#else
+#define PROFILE_EVENTS(zone)
+#endif
+
+#if defined(PROFILER) || defined(TIMELINE)
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT2(a, b)
+#define PROFILE_ZONE(zone)    PROFILE_STATS(zone) PROFILE_EVENTS(zone) do {} while (0)
+#else
+#define PROFILE_ZONE(zone)    do {} while (0)
+#endif
+
+#endif // PROFILER_H
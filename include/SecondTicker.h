@@ -0,0 +1,35 @@
+#ifndef SECOND_TICKER_H
+#define SECOND_TICKER_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <time.h>
+
+// Wakes a task right as each second of the system clock starts. An
+// esp_timer is armed for the next boundary, worked out from gettimeofday()
+// each time, so it follows NTP steps and slewing. Its callback hands the
+// second over and arms the next one.
+//
+// The latency from the boundary to wait() returning is the esp_timer
+// dispatch, tens of microseconds, whatever the loop is busy with.
+class SecondTicker {
+public:
+    bool begin();
+    bool running() const { return timer != nullptr; }
+
+    // blocks until a second starts, false on timeout
+    bool wait(time_t* second, TickType_t timeout = portMAX_DELAY);
+
+    // latest the timer fired after a boundary since the last call, in us
+    uint32_t maxLate();
+
+private:
+    static void fire(void* arg);
+
+    esp_timer_handle_t timer = nullptr;
+    SemaphoreHandle_t ready = nullptr;
+    volatile time_t second = 0;
+    volatile uint32_t max_late = 0;
+};
+
+#endif // SECOND_TICKER_H
@@ -0,0 +1,30 @@
+#ifndef SPAN_CANVAS_H
+#define SPAN_CANVAS_H
+
+#include "DisplayManager.h"
+
+// A logical canvas laid across several panels. Every panel showing the
+// canvas face has an offset on it (Panel::canvas_x/y) and shows the slice
+// of the canvas at that offset. The scene is drawn once per panel into the
+// panel sized sprite with the offset subtracted, so primitives clip to the
+// slice and nothing outside it is rasterized.
+class SpanCanvas {
+public:
+    void begin(const DisplayManager& displays, uint8_t face, int16_t panel_w, int16_t panel_h);
+
+    int16_t width() const { return x1 - x0; }
+    int16_t height() const { return y1 - y0; }
+
+    // Offset of a panel's top left corner from the canvas' top left
+    float sliceX(const Panel& panel) const { return panel.canvas_x - x0; }
+    float sliceY(const Panel& panel) const { return panel.canvas_y - y0; }
+
+    // Does the canvas box (left, top)-(right, bottom) show on the panel
+    bool visible(const Panel& panel, float left, float top, float right, float bottom) const;
+
+private:
+    int16_t panel_w = 0, panel_h = 0;
+    int16_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;   // bounds in panel offset units
+};
+
+#endif // SPAN_CANVAS_H
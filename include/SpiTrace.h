@@ -0,0 +1,70 @@
+#ifndef SPI_TRACE_H
+#define SPI_TRACE_H
+
+#include <Arduino.h>
+
+// Recorder for what goes over the panel SPI buses: CS selections, address
+// windows, other commands and the pixel data, split into frames. Built with
+// -D SPI_TRACE=<frames> the first frames of loop() are recorded and dumped
+// to Serial once. tools/spi_trace.py captures the dump and replays it into
+// a framebuffer per panel.
+//
+// The trace is a header ("SPTR", version, panel width, height, frames)
+// followed by records, all little endian:
+//   'F' u32 micros                  start of a frame
+//   'S' u8 bus, u32 panel mask      CS lines that changed
+//   'W' u8 bus, u16 x, y, w, h      address window (CASET, RASET, RAMWR)
+//   'C' u8 bus, u8 cmd, u8 len, data  any other command
+//   'P' u8 bus, u32 count, runs     pixels, as (u16 length, u16 colour) runs
+//   'E' u8 truncated                end, 1 if the buffer filled up early
+// Colours are in panel order, as they go over the wire.
+//
+// The bus code records through the hooks below, without SPI_TRACE they
+// compile to nothing.
+#ifdef SPI_TRACE
+class SpiTrace {
+public:
+    static const uint8_t VERSION = 1;
+
+    bool begin(uint16_t frames, uint16_t width, uint16_t height);
+    void frame();   // dumps the trace once the last frame is recorded
+
+    void select(uint8_t bus, uint32_t mask);
+    void window(uint8_t bus, int32_t x, int32_t y, int32_t w, int32_t h);
+    void command(uint8_t bus, uint8_t cmd, const uint8_t* data, uint8_t len);
+    void pixels(uint8_t bus, const uint16_t* pixels, uint32_t count);
+
+private:
+    enum State : uint8_t { IDLE, RECORDING, FULL, DONE };
+
+    bool lock();
+    void unlock() { xSemaphoreGive(mutex); }
+    bool room(uint32_t bytes);
+    void put8(uint8_t v) { buf[pos++] = v; }
+    void put16(uint16_t v) { put8(v); put8(v >> 8); }
+    void put32(uint32_t v) { put16(v); put16(v >> 16); }
+    void dump();
+
+    uint8_t* buf = nullptr;
+    uint32_t size = 0;
+    uint32_t pos = 0;
+    uint16_t frames = 0;
+    uint16_t frames_done = 0;
+    volatile State state = IDLE;
+    SemaphoreHandle_t mutex = nullptr;
+};
+
+extern SpiTrace spi_trace;
+
+#define SPI_TRACE_SELECT(bus, mask)          spi_trace.select(bus, mask)
+#define SPI_TRACE_WINDOW(bus, x, y, w, h)    spi_trace.window(bus, x, y, w, h)
+#define SPI_TRACE_COMMAND(bus, cmd, d, len)  spi_trace.command(bus, cmd, d, len)
+#define SPI_TRACE_PIXELS(bus, p, count)      spi_trace.pixels(bus, p, count)
+#else
+#define SPI_TRACE_SELECT(bus, mask)          do {} while (0)
+#define SPI_TRACE_WINDOW(bus, x, y, w, h)    do {} while (0)
+#define SPI_TRACE_COMMAND(bus, cmd, d, len)  do {} while (0)
+#define SPI_TRACE_PIXELS(bus, p, count)      do {} while (0)
+#endif
+
+#endif // SPI_TRACE_H
@@ -0,0 +1,58 @@
+#ifndef TIME_ZONE_H
+#define TIME_ZONE_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#endif
+#include <time.h>
+
+// Local time from UTC without going through localtime_r() and the global
+// TZ. The POSIX TZ string ("CET-1CEST-2,M3.5.0/02:00:00,M10.5.0/03:00:00")
+// is parsed once. The offset in force, and the UTC span it holds for
+// (between two DST changes), are cached, so a conversion is an add and two
+// compares, the rules are only worked out again at a DST change. Looking
+// up writes that cache, a TimeZone belongs to one task, copy it for another.
+//
+// Rules can be Mm.w.d (day d of week w of month m, 5 is the last), Jn
+// (day 1-365, no Feb 29th) or n (day 0-365), each with an optional /time,
+// which may be negative or over 24h. A zone with a DST name but no rules
+// gets the US ones, like newlib.
+class TimeZone {
+public:
+    bool parse(const char* posix);
+
+    // seconds to add to UTC for the local time
+    int32_t offset(time_t utc, bool* dst = nullptr);
+    // seconds since local midnight
+    int32_t daySeconds(time_t utc, bool* dst = nullptr);
+
+private:
+    struct Rule {
+        char kind;          // 'M', 'J' or 'D' (plain day number)
+        uint8_t month, week, weekday;
+        uint16_t day;
+        int32_t time;       // seconds after local midnight
+    };
+
+    bool read(const char* posix);
+    static bool parseName(const char*& p);
+    static bool parseTime(const char*& p, int32_t* secs);
+    static bool parseRule(const char*& p, Rule* rule);
+    time_t transition(int year, const Rule& rule, int32_t offset_before) const;
+    void update(time_t utc);
+
+    int32_t std_offset = 0;
+    int32_t dst_offset = 0;
+    bool has_dst = false;
+    Rule start, end;
+
+    // the offset in force from valid_from up to valid_until
+    time_t valid_from = 1;
+    time_t valid_until = 0;
+    int32_t current = 0;
+    bool current_dst = false;
+};
+
+#endif // TIME_ZONE_H
@@ -0,0 +1,86 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+// Begin/end and instant events with a timestamp, built with
+// -D TIMELINE=<events> (a power of two, the ring size). The profiler zones
+// (see Profiler.h) record into it, so do CS changes and NTP syncs. The loop
+// streams the events out over Serial as it goes, only as much as fits in
+// the UART buffer without blocking. tools/timeline.py turns the stream
+// into a Chrome trace (chrome://tracing or ui.perfetto.dev) to see render,
+// pushes and CS switching on both cores side by side.
+//
+// Serial carries, mixed in with the text output:
+//   "\nTIMELINE_NAMES name,name,...\n"   event names by id, every few seconds
+//   "\nTIMELINE <n> <dropped>\n"         then n events of 12 bytes:
+//     u32 micros, u32 argument, u8 id,
+//     u8 phase (0 begin, 1 end, 2 instant) | core << 7, u16 unused,
+//     little endian
+// dropped counts events lost since the last chunk because the ring was full.
+// A chunk, or the names line, goes out in one Serial.write(), which holds
+// the UART for all of it: text printed by tasks on the other core lands
+// between chunks, never inside one.
+//
+// The ring is a bounded lock-free queue with a sequence number per slot,
+// any task on either core can record, the loop is the only reader.
+#ifdef TIMELINE
+#include <Arduino.h>
+#include <atomic>
+
+class Timeline {
+public:
+    enum Phase : uint8_t { BEGIN, END, INSTANT };
+
+    struct Event {
+        uint32_t us;
+        uint32_t arg;       // a whole panel mask for CS changes
+        uint8_t id;
+        uint8_t phase;
+        uint16_t unused;
+    };
+
+    class Scope {
+    public:
+        Scope(uint8_t id);
+        ~Scope();
+    private:
+        uint8_t id;
+    };
+
+    Timeline();
+    void begin(const char* const* names, uint8_t count);
+    void record(uint8_t id, Phase phase, uint32_t arg = 0);
+    void drain();   // from loop()
+
+private:
+    static const uint32_t SIZE = TIMELINE;
+    static const uint32_t CHUNK = 16;   // events per drain at most
+    static const uint32_t MASK = SIZE - 1;
+    static_assert((SIZE & MASK) == 0, "TIMELINE must be a power of two");
+
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        Event event;
+    };
+
+    void sendNames();
+
+    Slot ring[SIZE];
+    std::atomic<uint32_t> head{0};
+    uint32_t tail = 0;
+    std::atomic<uint32_t> dropped{0};
+    const char* const* names = nullptr;
+    uint8_t name_count = 0;
+    uint32_t names_sent = 0;
+};
+
+extern Timeline timeline;
+
+inline Timeline::Scope::Scope(uint8_t id) : id(id) { timeline.record(id, BEGIN); }
+inline Timeline::Scope::~Scope() { timeline.record(id, END); }
+
+#define TIMELINE_MARK(id, arg)  timeline.record(id, Timeline::INSTANT, arg)
+#else
+#define TIMELINE_MARK(id, arg)  do {} while (0)
+#endif
+
+#endif // TIMELINE_H
@@ -3,10 +3,11 @@
 
 #include <WiFiManager.h>
 #include <time.h>
+#include "NtpClient.h"
 
 class WifiTimeLib {
 public:
-    WifiTimeLib(const char* ntp_server, const char* tz_info);
+    WifiTimeLib(NtpClient* ntp, const char* tz_info);
     String getFormattedDate();
     String getFormattedTime();
     bool connectToWiFi(const char* ap_name);
@@ -16,7 +17,7 @@ public:
 private:
     tm timeinfo;
     time_t now;
-    const char* NTP_SERVER;
+    NtpClient* ntp;
     const char* TZ_INFO;
     WiFiManager wm;   // looking for credentials? don't need em! ... google "ESP32 WiFiManager"
 };
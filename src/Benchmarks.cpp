@@ -0,0 +1,235 @@
+#ifdef CLOCK_BENCHMARKS
+
+#include <Arduino.h>
+#include "Benchmarks.h"
+#include "ClockSprite.h"
+#include "Pixel565.h"
+
+extern TFT_eSPI tft;
+
+#define BENCH_ITERATIONS 1000
+
+static uint32_t cyclesToNs(uint32_t cycles) {
+    return cycles * 1000 / ESP.getCpuFreqMHz();
+}
+
+// =========================================================================
+// Glyph lookup: library linear scan vs GlyphIndex, for every font in data/
+// =========================================================================
+static void benchGlyphLookup() {
+    static const char* fonts[] = {
+        "Futura-MediumItalic-18", "Futura-MediumItalic-28", "Mali-Bold-60", "Mali-Bold-90"
+    };
+    // what the faces actually draw: digits, dates and labels
+    static const char sample[] = "0123456789:  Mon Tue Wed Thu Fri Sat Sun 12:59:59 ZURICH";
+    const int sample_len = sizeof(sample) - 1;
+
+    ClockSprite font_sprite = ClockSprite(&tft);
+    volatile uint16_t sink = 0;
+
+    Serial.println("glyph lookup, ns per character (linear / indexed):");
+    for (const char* name : fonts) {
+        font_sprite.loadFont(name);
+        if (!font_sprite.fontLoaded) {
+            Serial.printf("  %-24s not found\n", name);
+            continue;
+        }
+
+        uint16_t index = 0;
+        uint32_t start = ESP.getCycleCount();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            for (int c = 0; c < sample_len; c++) {
+                font_sprite.getUnicodeIndex(sample[c], &index);
+                sink += index;
+            }
+        }
+        uint32_t linear = ESP.getCycleCount() - start;
+
+        start = ESP.getCycleCount();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            for (int c = 0; c < sample_len; c++) {
+                font_sprite.glyphIndex().find(sample[c], &index);
+                sink += index;
+            }
+        }
+        uint32_t indexed = ESP.getCycleCount() - start;
+
+        uint32_t chars = BENCH_ITERATIONS * sample_len;
+        Serial.printf("  %-24s %4d glyphs  %6u / %4u\n", name, font_sprite.gFont.gCount,
+                      (unsigned)cyclesToNs(linear / chars), (unsigned)cyclesToNs(indexed / chars));
+        font_sprite.unloadFont();
+    }
+}
+
+// =========================================================================
+// Anti-aliased primitives: library blend vs BlendLut lookups
+// =========================================================================
+#define BENCH_SHAPES 60
+
+// The same shapes on a plain TFT_eSprite (the library code all the way
+// down) or a ClockSprite, reset to the background after each
+template <class Sprite>
+static void timeShapes(Sprite& sprite, uint32_t cycles[3]) {
+    sprite.fillSprite(TFT_DARKGREEN);
+    for (int i = 0; i < BENCH_SHAPES; i++) {
+        float a = i * 6 * 0.0174532925f;
+        float x = 120 + 100 * cosf(a), y = 120 + 100 * sinf(a);
+
+        uint32_t start = ESP.getCycleCount();
+        sprite.drawWideLine(120, 120, x, y, 8.0f, TFT_LIGHTGREY);
+        cycles[0] += ESP.getCycleCount() - start;
+        sprite.fillSprite(TFT_DARKGREEN);
+
+        start = ESP.getCycleCount();
+        sprite.drawWedgeLine(120, 120, x, y, 3.5f, 1.5f, TFT_YELLOW);
+        cycles[1] += ESP.getCycleCount() - start;
+        sprite.fillSprite(TFT_DARKGREEN);
+
+        start = ESP.getCycleCount();
+        sprite.fillSmoothCircle(x, y, 8, TFT_LIGHTGREY);
+        cycles[2] += ESP.getCycleCount() - start;
+        sprite.fillSprite(TFT_DARKGREEN);
+    }
+}
+
+// One sprite at a time, two full faces may not fit next to each other
+static void benchPrimitives() {
+    uint32_t lib_cycles[3] = {0, 0, 0};
+    uint32_t lut_cycles[3] = {0, 0, 0};
+
+    TFT_eSprite library = TFT_eSprite(&tft);
+    if (!library.createSprite(240, 240)) {
+        Serial.println("primitives: no memory for sprite");
+        return;
+    }
+    timeShapes(library, lib_cycles);
+    library.deleteSprite();
+
+    ClockSprite face = ClockSprite(&tft);
+    if (!face.createSprite(240, 240)) {
+        Serial.println("primitives: no memory for sprite");
+        return;
+    }
+    static BlendLut lut;   // 8 KB, keep it off the loop task stack
+    lut.registerPair(TFT_LIGHTGREY, TFT_DARKGREEN);
+    lut.registerPair(TFT_YELLOW, TFT_DARKGREEN);
+    face.setBlendLut(&lut);
+    timeShapes(face, lut_cycles);
+    face.deleteSprite();
+
+    static const char* names[] = {"drawWideLine 8px", "drawWedgeLine 3.5-1.5", "fillSmoothCircle r8"};
+    Serial.println("AA primitives, us per call (library / blend lut):");
+    for (int p = 0; p < 3; p++) {
+        Serial.printf("  %-24s %6u / %6u\n", names[p],
+                      (unsigned)(cyclesToNs(lib_cycles[p] / BENCH_SHAPES) / 1000),
+                      (unsigned)(cyclesToNs(lut_cycles[p] / BENCH_SHAPES) / 1000));
+    }
+}
+
+// =========================================================================
+// Word wide kernels on a full 240x240 face
+// =========================================================================
+#define BENCH_RUNS 10
+
+// full fill and a big rectangle, in cycles for all the runs
+template <class Sprite>
+static void timeFills(Sprite& sprite, uint32_t* fill, uint32_t* rect) {
+    uint32_t start = ESP.getCycleCount();
+    for (int i = 0; i < BENCH_RUNS; i++) sprite.fillSprite(TFT_DARKGREEN);
+    *fill = ESP.getCycleCount() - start;
+    start = ESP.getCycleCount();
+    for (int i = 0; i < BENCH_RUNS; i++) sprite.fillRect(10, 10, 220, 220, TFT_BLUE);
+    *rect = ESP.getCycleCount() - start;
+}
+
+static void benchKernels() {
+    uint32_t lib_fill, lib_rect, fill, rect;
+    TFT_eSprite library = TFT_eSprite(&tft);
+    if (!library.createSprite(240, 240)) {
+        Serial.println("kernels: no memory for sprite");
+        return;
+    }
+    timeFills(library, &lib_fill, &lib_rect);
+    library.deleteSprite();
+
+    ClockSprite face = ClockSprite(&tft);
+    if (!face.createSprite(240, 240)) {
+        Serial.println("kernels: no memory for sprite");
+        return;
+    }
+    timeFills(face, &fill, &rect);
+
+    uint16_t* pixels = (uint16_t*)face.getPointer();
+    uint16_t* copy = (uint16_t*)malloc(240 * 240 * 2);
+    const uint32_t count = 240 * 240;
+    uint32_t mem_copy = 0, word_copy = 0;
+    if (copy) {
+        uint32_t start = ESP.getCycleCount();
+        for (int i = 0; i < BENCH_RUNS; i++) memcpy(copy, pixels, count * 2);
+        mem_copy = ESP.getCycleCount() - start;
+        start = ESP.getCycleCount();
+        for (int i = 0; i < BENCH_RUNS; i++) copy565(copy, pixels, count);
+        word_copy = ESP.getCycleCount() - start;
+        free(copy);
+    }
+
+    const int runs = BENCH_RUNS;
+    Serial.println("57,600 pixel kernels, us per call (before / word wide):");
+    Serial.printf("  %-24s %6u / %6u\n", "fillSprite", (unsigned)(cyclesToNs(lib_fill / runs) / 1000), (unsigned)(cyclesToNs(fill / runs) / 1000));
+    Serial.printf("  %-24s %6u / %6u\n", "fillRect 220x220", (unsigned)(cyclesToNs(lib_rect / runs) / 1000), (unsigned)(cyclesToNs(rect / runs) / 1000));
+    Serial.printf("  %-24s %6u / %6u\n", "dial copy (memcpy)", (unsigned)(cyclesToNs(mem_copy / runs) / 1000), (unsigned)(cyclesToNs(word_copy / runs) / 1000));
+    face.deleteSprite();
+}
+
+// =========================================================================
+// Push modes for a full face, with DMA up (as the faces run) and with the
+// CPU feeding the bus. No panel is selected, so this is bus and CPU time
+// only and nothing shows up on screen.
+// =========================================================================
+static uint32_t pushUs(ClockSprite& face, ClockSprite::PushMode mode) {
+    const int runs = 5;
+    face.setPushMode(mode);
+    uint32_t start = micros();
+    for (int i = 0; i < runs; i++) face.push(0, 0);
+    return (micros() - start) / runs;
+}
+
+static void benchPush() {
+    ClockSprite face = ClockSprite(&tft);
+    if (!face.createSprite(240, 240)) {
+        Serial.println("push: no memory for sprite");
+        return;
+    }
+    face.fillSprite(TFT_DARKGREEN);
+    face.fillSmoothCircle(120, 120, 60, TFT_LIGHTGREY);
+
+    static const ClockSprite::PushMode modes[] = {ClockSprite::PUSH_OPAQUE, ClockSprite::PUSH_KEYED, ClockSprite::PUSH_CIRCLE};
+    static const char* names[] = {"opaque", "colour keyed", "circle"};
+    uint32_t dma[3], cpu[3];
+    bool had_dma = tft.DMA_Enabled;
+    if (!had_dma) tft.initDMA();
+    bool dma_ready = face.dmaReady();
+    for (int m = 0; m < 3; m++) dma[m] = pushUs(face, modes[m]);
+    tft.deInitDMA();
+    for (int m = 0; m < 3; m++) cpu[m] = pushUs(face, modes[m]);
+    if (had_dma) tft.initDMA();
+
+    // with DMA the circle is the opaque push, compare the CPU rows with that
+    Serial.printf("240x240 push, us per frame (DMA%s / CPU):\n", dma_ready ? "" : " not usable");
+    for (int m = 0; m < 3; m++) {
+        Serial.printf("  %-24s %6u / %6u\n", names[m], (unsigned)dma[m], (unsigned)cpu[m]);
+    }
+    Serial.printf("  %-24s %6u / %6u\n", "opaque DMA, circle CPU", (unsigned)dma[0], (unsigned)cpu[2]);
+    face.deleteSprite();
+}
+
+void runBenchmarks() {
+    Serial.println("Running benchmarks...");
+    benchGlyphLookup();
+    benchPrimitives();
+    benchKernels();
+    benchPush();
+    Serial.println("Benchmarks done.");
+}
+
+#endif // CLOCK_BENCHMARKS
@@ -0,0 +1,37 @@
+#include "BlendLut.h"
+#include "Pixel565.h"
+
+static inline uint32_t pairKey(uint16_t fg, uint16_t bg) {
+    return ((uint32_t)fg << 16) | bg;
+}
+
+// returns the table for the pair, or nullptr when all slots are used
+const uint16_t* BlendLut::registerPair(uint16_t fg, uint16_t bg) {
+    const uint16_t* table = find(fg, bg);
+    if (table) return table;
+    if (count == MAX_PAIRS) return nullptr;
+
+    uint16_t* entry = tables[count];
+    for (uint16_t alpha = 0; alpha < 256; alpha++) {
+        entry[alpha] = panelOrder(blend(alpha, fg, bg));
+    }
+    keys[count++] = pairKey(fg, bg);
+    return entry;
+}
+
+const uint16_t* BlendLut::find(uint16_t fg, uint16_t bg) const {
+    uint32_t key = pairKey(fg, bg);
+    for (uint8_t i = 0; i < count; i++) {
+        if (keys[i] == key) return tables[i];
+    }
+    return nullptr;
+}
+
+uint16_t BlendLut::blend(uint8_t alpha, uint16_t fg, uint16_t bg) {
+    // red and blue blended together at 6 bit precision, green at 8 bit
+    uint32_t rxb = bg & 0xF81F;
+    rxb += ((fg & 0xF81F) - rxb) * (alpha >> 2) >> 6;
+    uint32_t xgx = bg & 0x07E0;
+    xgx += ((fg & 0x07E0) - xgx) * alpha >> 8;
+    return (rxb & 0xF81F) | (xgx & 0x07E0);
+}
@@ -0,0 +1,94 @@
+#include "ClockDiscipline.h"
+#include <sys/time.h>
+
+bool ClockDiscipline::correct(int64_t offset_us, Source from) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (from != source) return false;
+    int64_t now = esp_timer_get_time();
+    if (!synced() || llabs(offset_us) > STEP_US) {
+        if (!step(offset_us)) return false;
+        drift_from = now;
+        drift_sum = 0;
+    } else {
+        slew(offset_us);
+        last_stepped = false;
+        if (!drift_from) {
+            // the first one after a source change is how far apart they are
+            drift_from = now;
+            drift_sum = 0;
+        } else {
+            // what built up past the drift tick() would have slewed in
+            // since it last ran is the error of the estimate. Half of it,
+            // readings are noisy
+            drift_sum += offset_us - (int64_t)(drift_ppm * (now - last_tick) / 1e6f);
+            float interval_s = (now - drift_from) / 1e6f;
+            if (interval_s >= MIN_DRIFT_S) {
+                limitDrift(drift_ppm + drift_sum / interval_s / 2);
+                drift_from = now;
+                drift_sum = 0;
+            }
+        }
+    }
+    synced_by |= 1 << from;
+    last_sync = time(nullptr);
+    last_tick = now;
+    return true;
+}
+
+void ClockDiscipline::tick() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!synced()) return;
+    int64_t now = esp_timer_get_time();
+    slew((int64_t)(drift_ppm * (now - last_tick) / 1e6f));
+    last_tick = now;
+}
+
+void ClockDiscipline::resume(int64_t offset_us) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (llabs(offset_us) > STEP_US) step(offset_us);
+    else slew(offset_us);
+    resumed = true;
+    last_tick = esp_timer_get_time();
+}
+
+// the two sources disagree a little, that isn't drift
+void ClockDiscipline::follow(Source to) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (to == source) return;
+    source = to;
+    drift_from = 0;
+}
+
+void ClockDiscipline::setDrift(float ppm) {
+    std::lock_guard<std::mutex> guard(lock);
+    limitDrift(ppm);
+}
+
+void ClockDiscipline::limitDrift(float ppm) {
+    if (ppm > MAX_DRIFT_PPM) ppm = MAX_DRIFT_PPM;
+    if (ppm < -MAX_DRIFT_PPM) ppm = -MAX_DRIFT_PPM;
+    drift_ppm = ppm;
+}
+
+bool ClockDiscipline::step(int64_t offset_us) {
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    int64_t us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec + offset_us;
+    tv.tv_sec = us / 1000000;
+    tv.tv_usec = us % 1000000;
+    // also drops a slew still going
+    if (settimeofday(&tv, nullptr) != 0) return false;
+    last_stepped = true;
+    return true;
+}
+
+// adjtime() replaces the slew still going, add it back in
+void ClockDiscipline::slew(int64_t delta_us) {
+    timeval left = {0, 0};
+    adjtime(nullptr, &left);
+    delta_us += (int64_t)left.tv_sec * 1000000 + left.tv_usec;
+    timeval tv;
+    tv.tv_sec = delta_us / 1000000;
+    tv.tv_usec = delta_us % 1000000;
+    adjtime(&tv, nullptr);
+}
@@ -0,0 +1,80 @@
+#include "ClockMemory.h"
+#include <Preferences.h>
+#include <sys/time.h>
+
+#define NVS_NAMESPACE  "clock"
+#define RECORD_MAGIC   0x434C4B31   // "CLK1"
+
+// no padding inside, the check covers every byte before it
+struct Record {
+    int64_t saved;        // UTC of the last save
+    int64_t last_sync;
+    uint32_t magic;
+    float drift;
+    uint32_t check;
+};
+
+// not cleared by a reset or deep sleep, random after power on
+static RTC_NOINIT_ATTR Record record;
+
+static uint32_t checksum(const Record& r) {
+    // FNV-1a over all but the check
+    const uint8_t* p = (const uint8_t*)&r;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(Record, check); i++) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+bool ClockMemory::resume(ClockDiscipline* clock) {
+    Preferences prefs;
+    float drift = 0;
+    if (prefs.begin(NVS_NAMESPACE, true)) {
+        drift = prefs.getFloat("drift", 0);
+        last_sync = prefs.getLong64("synced", 0);
+        prefs.end();
+    }
+    nvs_drift = drift;
+    nvs_sync = last_sync;
+
+    bool kept = record.magic == RECORD_MAGIC && record.check == checksum(record);
+    if (kept) {
+        // newer than NVS
+        drift = record.drift;
+        last_sync = record.last_sync;
+    }
+    clock->setDrift(drift);
+
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    if (!kept || tv.tv_sec < MIN_VALID) return false;
+    int64_t gap = tv.tv_sec - record.saved;
+    clock->resume(gap >= 0 && gap <= MAX_GAP_S ? (int64_t)(drift * gap) : 0);
+    return true;
+}
+
+void ClockMemory::save(const ClockDiscipline& clock) {
+    if (!clock.synced()) return;
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    time_t now = tv.tv_sec;
+    if (clock.lastSync()) last_sync = clock.lastSync();
+    float drift = clock.drift();
+
+    record.magic = RECORD_MAGIC;
+    record.saved = now;
+    record.last_sync = last_sync;
+    record.drift = drift;
+    record.check = checksum(record);
+
+    bool moved = fabsf(drift - nvs_drift) >= NVS_DRIFT_PPM && now - nvs_written >= NVS_DRIFT_S;
+    bool synced = last_sync != nvs_sync && now - nvs_written >= NVS_SYNC_S;
+    if (!moved && !synced) return;
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, false)) return;
+    prefs.putFloat("drift", drift);
+    prefs.putLong64("synced", last_sync);
+    prefs.end();
+    nvs_drift = drift;
+    nvs_sync = last_sync;
+    nvs_written = now;
+}
@@ -0,0 +1,25 @@
+#include "ClockSource.h"
+#include <sys/time.h>
+
+void SystemClock::now(time_t* utc, uint32_t* us) {
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    *utc = tv.tv_sec;
+    *us = tv.tv_usec;
+}
+
+void WarpClock::start(time_t from) {
+    this->from = from;
+    last_us = micros();
+    real_us = 0;
+    sim_us = 0;
+}
+
+void WarpClock::now(time_t* utc, uint32_t* us) {
+    uint32_t t = micros();
+    real_us += (uint32_t)(t - last_us);
+    last_us = t;
+    sim_us = (uint64_t)(real_us * (double)speed);
+    *utc = epoch();
+    *us = sim_us % US_PER_SEC;
+}
@@ -0,0 +1,563 @@
+#include "ClockSprite.h"
+#include "Pixel565.h"
+#include "SpiTrace.h"
+#include "PixelHeat.h"
+#if __has_include(<esp_memory_utils.h>)
+#include <esp_memory_utils.h>
+#else
+#include <soc/soc_memory_layout.h>
+#endif
+
+// Edge thresholds, as used by the library's smooth graphics
+static const float LO_ALPHA = 1.0f / 32.0f;
+static const float HI_ALPHA = 1.0f - LO_ALPHA;
+
+// Heatmap counting, see PixelHeat.h
+#ifdef PIXEL_HEATMAP
+#define HEAT_SCOPE(p)        PixelHeat::Scope heat_scope(heat, PixelHeat::p)
+#define HEAT_WRITE(x, y, n)  do { if (heat) heat->write(x, y, n); } while (0)
+#define HEAT_BLEND(x, y)     do { if (heat) heat->blend(x, y); } while (0)
+#else
+#define HEAT_SCOPE(p)        do {} while (0)
+#define HEAT_WRITE(x, y, n)  do {} while (0)
+#define HEAT_BLEND(x, y)     do {} while (0)
+#endif
+
+// How an anti-aliased primitive colours its pixels
+struct ClockSprite::Paint {
+    uint16_t color;        // foreground
+    uint16_t solid;        // foreground, panel order
+    uint16_t bg;           // background, panel order
+    uint16_t bg_color;     // background
+    bool read_bg;          // background unknown, check the pixel underneath
+    const uint16_t* lut;   // blends of color over bg_color, or nullptr
+};
+
+void ClockSprite::loadFont(String font_name) {
+    TFT_eSprite::loadFont(font_name);
+    glyph_index.build(gUnicode, fontLoaded ? gFont.gCount : 0);
+}
+
+void ClockSprite::loadFont(const uint8_t array[]) {
+    TFT_eSprite::loadFont(array);
+    glyph_index.build(gUnicode, fontLoaded ? gFont.gCount : 0);
+}
+
+void ClockSprite::unloadFont() {
+    TFT_eSprite::unloadFont();
+    glyph_index.clear();
+}
+
+// Same as TFT_eSprite::drawGlyph() for the common case: a created sprite and
+// no background fill. Anything else goes to the library.
+void ClockSprite::drawGlyph(uint16_t code) {
+    if (!_created || _fillbg || code == '\n') {
+        TFT_eSprite::drawGlyph(code);
+        return;
+    }
+    HEAT_SCOPE(TEXT);
+
+    uint16_t fg = textcolor;
+    uint16_t bg = textbgcolor;
+
+    if (code == ' ') {
+        cursor_x += gFont.spaceWidth;
+        bg_cursor_x = cursor_x;
+        last_cursor_x = cursor_x;
+        return;
+    }
+
+    uint16_t g = 0;
+    if (!glyph_index.find(code, &g)) {
+        // code point not in font, draw a box like the library does
+        drawRect(cursor_x, cursor_y + gFont.maxAscent - gFont.ascent, gFont.spaceWidth, gFont.ascent, fg);
+        cursor_x += gFont.spaceWidth + 1;
+        bg_cursor_x = cursor_x;
+        last_cursor_x = cursor_x;
+        return;
+    }
+
+    if (textwrapX && (cursor_x + gWidth[g] + gdX[g]) > width()) {
+        cursor_y += gFont.yAdvance;
+        cursor_x = 0;
+    }
+    if (textwrapY && (cursor_y + gFont.yAdvance) > height()) cursor_y = 0;
+    if (cursor_x == 0) cursor_x -= gdX[g];
+
+    int32_t cy = cursor_y + gFont.maxAscent - gdY[g];
+    int32_t cx = cursor_x + gdX[g];
+    uint8_t w = gWidth[g];
+
+    // nothing to draw outside the sprite, e.g. text running across panels
+    if (cx >= _iwidth || cx + w <= 0 || cy >= _iheight || cy + gHeight[g] <= 0) {
+        cursor_x += gxAdvance[g];
+        bg_cursor_x = cursor_x;
+        last_cursor_x = cursor_x;
+        return;
+    }
+
+    bool store = known_bg && _bpp == 16;
+    if (store) updateTextRamp();
+
+    uint8_t row[256];
+    const uint8_t* bitmap = gFont.gArray ? gFont.gArray + gBitmap[g] : nullptr;
+#ifdef FONT_FS_AVAILABLE
+    if (fs_font) fontFile.seek(gBitmap[g], fs::SeekSet);
+#endif
+
+    for (int32_t y = 0; y < gHeight[g]; y++) {
+#ifdef FONT_FS_AVAILABLE
+        if (fs_font) fontFile.read(row, w);
+        else
+#endif
+        {
+            for (int32_t x = 0; x < w; x++) row[x] = pgm_read_byte(bitmap + x);
+            bitmap += w;
+        }
+
+        if (store) storeGlyphRow(row, w, cx, y + cy);
+        else blendGlyphRow(row, w, cx, y + cy, fg, bg);
+    }
+
+    cursor_x += gxAdvance[g];
+    bg_cursor_x = cursor_x;
+    last_cursor_x = cursor_x;
+}
+
+// Solid pixels are batched into runs, edge pixels are blended with the
+// library's alphaBlend()
+void ClockSprite::blendGlyphRow(const uint8_t* alpha, uint8_t w, int32_t cx, int32_t y, uint16_t fg, uint16_t bg) {
+    int32_t run_x = 0;
+    int32_t run = 0;
+    for (int32_t x = 0; x < w; x++) {
+        if (alpha[x] == 0xFF) {
+            if (run == 0) run_x = x + cx;
+            run++;
+            continue;
+        }
+        if (run) { drawFastHLine(run_x, y, run, fg); run = 0; }
+        if (!alpha[x]) continue;
+        drawPixel(x + cx, y, alphaBlend(alpha[x], fg, bg));
+        HEAT_BLEND(x + cx, y);
+    }
+    if (run) drawFastHLine(run_x, y, run, fg);
+}
+
+// Known background: every glyph pixel is a ramp lookup and a store straight
+// into the sprite buffer, no blending and no reads
+void ClockSprite::storeGlyphRow(const uint8_t* alpha, uint8_t w, int32_t cx, int32_t y) {
+    if (y < 0 || y >= height()) return;
+    int32_t x0 = cx < 0 ? -cx : 0;
+    int32_t x1 = cx + w > width() ? width() - cx : w;
+
+    uint16_t* line = _img + y * _iwidth;
+    for (int32_t x = x0; x < x1; x++) {
+        uint8_t a = alpha[x];
+        if (!a) continue;
+        line[cx + x] = a == 0xFF ? text_solid : text_ramp[a >> TEXT_RAMP_SHIFT];
+        HEAT_WRITE(cx + x, y, 1);
+    }
+}
+
+// The ramp is kept in panel order, ready to store
+void ClockSprite::updateTextRamp() {
+    if (ramp_fg == textcolor && ramp_bg == textbgcolor) return;
+    ramp_fg = textcolor;
+    ramp_bg = textbgcolor;
+
+    for (uint16_t i = 0; i < TEXT_RAMP_STEPS; i++) {
+        // centre of the alpha range that maps onto this step
+        uint8_t alpha = (i << TEXT_RAMP_SHIFT) + (1 << (TEXT_RAMP_SHIFT - 1));
+        text_ramp[i] = panelOrder(alphaBlend(alpha, ramp_fg, ramp_bg));
+    }
+    text_solid = panelOrder(ramp_fg);
+}
+
+// =========================================================================
+// Anti-aliased primitives
+// =========================================================================
+void ClockSprite::fillSprite(uint32_t color) {
+    HEAT_SCOPE(FILL);
+    if (_bpp == 16) {
+        fill565(_img, panelOrder(color), _iwidth * _iheight);
+        HEAT_WRITE(0, 0, _iwidth * _iheight);
+    }
+    else TFT_eSprite::fillSprite(color);
+    fill_color = color;
+}
+
+void ClockSprite::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) {
+    if (_bpp != 16) {
+        TFT_eSprite::drawFastHLine(x, y, w, color);
+        return;
+    }
+    if (y < 0 || y >= _iheight) return;
+    if (x < 0) { w += x; x = 0; }
+    if (x + w > _iwidth) w = _iwidth - x;
+    if (w <= 0) return;
+    fill565(_img + y * _iwidth + x, panelOrder(color), w);
+    HEAT_WRITE(x, y, w);
+}
+
+void ClockSprite::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    if (_bpp != 16) {
+        TFT_eSprite::fillRect(x, y, w, h, color);
+        return;
+    }
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > _iwidth) w = _iwidth - x;
+    if (y + h > _iheight) h = _iheight - y;
+    if (w <= 0 || h <= 0) return;
+
+    uint16_t stored = panelOrder(color);
+    uint16_t* line = _img + y * _iwidth + x;
+    if (w == _iwidth) {   // whole rows are one span
+        fill565(line, stored, w * h);
+        HEAT_WRITE(x, y, w * h);
+        return;
+    }
+    for (int32_t row = y; h; h--, row++, line += _iwidth) {
+        fill565(line, stored, w);
+        HEAT_WRITE(x, row, w);
+    }
+}
+
+// Without a bg_color the background is whatever was filled last, the edge
+// pixels check that before using the lookup table
+ClockSprite::Paint ClockSprite::makePaint(uint32_t fg_color, uint32_t bg_color) const {
+    Paint paint;
+    paint.color = fg_color;
+    paint.solid = panelOrder(fg_color);
+    paint.read_bg = bg_color == 0x00FFFFFF;
+    paint.bg_color = paint.read_bg ? fill_color : bg_color;
+    paint.bg = panelOrder(paint.bg_color);
+    paint.lut = blend_lut ? blend_lut->find(paint.color, paint.bg_color) : nullptr;
+    return paint;
+}
+
+// Sprite rotation isn't used, so _iwidth x _iheight is the drawable area
+void ClockSprite::plotEdge(int32_t x, int32_t y, uint8_t alpha, const Paint& paint) {
+    if (x < 0 || y < 0 || x >= _iwidth || y >= _iheight) return;
+    uint16_t* pixel = _img + y * _iwidth + x;
+    HEAT_BLEND(x, y);
+    if (paint.lut && (!paint.read_bg || *pixel == paint.bg)) {
+        *pixel = paint.lut[alpha];
+        return;
+    }
+    uint16_t bg = paint.read_bg ? panelOrder(*pixel) : paint.bg_color;
+    *pixel = panelOrder(BlendLut::blend(alpha, paint.color, bg));
+}
+
+static inline float wedgeDistance(float xpax, float ypay, float bax, float bay, float dr) {
+    float h = fmaxf(fminf((xpax * bax + ypay * bay) / (bax * bax + bay * bay), 1.0f), 0.0f);
+    float dx = xpax - bax * h, dy = ypay - bay * h;
+    return sqrtf(dx * dx + dy * dy) + h * dr;
+}
+
+void ClockSprite::drawWideLine(float ax, float ay, float bx, float by, float wd, uint32_t fg_color, uint32_t bg_color) {
+    drawWedgeLine(ax, ay, bx, by, wd / 2.0f, wd / 2.0f, fg_color, bg_color);
+}
+
+// Same distance field scan as TFT_eSPI::drawWedgeLine()
+void ClockSprite::drawWedgeLine(float ax, float ay, float bx, float by, float ar, float br, uint32_t fg_color, uint32_t bg_color) {
+    HEAT_SCOPE(LINE);
+    if (_bpp != 16) {
+        TFT_eSprite::drawWedgeLine(ax, ay, bx, by, ar, br, fg_color, bg_color);
+        return;
+    }
+    if (ar < 0.0f || br < 0.0f) return;
+    if (fabsf(ax - bx) < 0.01f && fabsf(ay - by) < 0.01f) bx += 0.01f;  // avoid divide by zero
+
+    // bounding box, clipped to the sprite
+    int32_t x0 = max((int32_t)floorf(fminf(ax - ar, bx - br)), (int32_t)0);
+    int32_t x1 = min((int32_t)ceilf(fmaxf(ax + ar, bx + br)), _iwidth - 1);
+    int32_t y0 = max((int32_t)floorf(fminf(ay - ar, by - br)), (int32_t)0);
+    int32_t y1 = min((int32_t)ceilf(fmaxf(ay + ar, by + br)), _iheight - 1);
+    if (x0 > x1 || y0 > y1) return;
+
+    // start on the row of the leftmost end, the left edge then only moves
+    // right as we scan away from it
+    int32_t ys = (ax - ar) > (bx - br) ? by : ay;
+    ys = constrain(ys, y0, y1 + 1);
+
+    Paint paint = makePaint(fg_color, bg_color);
+    float rdt = ar - br;
+    ar += 0.5f;
+    float bax = bx - ax, bay = by - ay;
+
+    int32_t xs = x0;
+    auto scanRow = [&](int32_t yp) {
+        uint16_t* line = _img + yp * _iwidth;
+        float ypay = yp - ay;
+        bool in_line = false;
+        for (int32_t xp = xs; xp <= x1; xp++) {
+            float alpha = ar - wedgeDistance(xp - ax, ypay, bax, bay, rdt);
+            if (alpha <= LO_ALPHA) {
+                if (in_line) break;   // past the right edge
+                continue;
+            }
+            if (!in_line) { in_line = true; xs = xp; }
+            if (alpha > HI_ALPHA) {
+                line[xp] = paint.solid;
+                HEAT_WRITE(xp, yp, 1);
+            }
+            else plotEdge(xp, yp, (uint8_t)(alpha * 255), paint);
+        }
+    };
+
+    for (int32_t yp = ys; yp <= y1; yp++) scanRow(yp);
+    xs = x0;
+    for (int32_t yp = ys - 1; yp >= y0; yp--) scanRow(yp);
+}
+
+// Same as TFT_eSPI::fillSmoothCircle(), one quadrant of edge pixels is
+// computed and mirrored
+void ClockSprite::fillSmoothCircle(int32_t x, int32_t y, int32_t r, uint32_t color, uint32_t bg_color) {
+    HEAT_SCOPE(CIRCLE);
+    if (_bpp != 16) {
+        TFT_eSprite::fillSmoothCircle(x, y, r, color, bg_color);
+        return;
+    }
+    if (r <= 0) return;
+
+    Paint paint = makePaint(color, bg_color);
+    drawFastHLine(x - r, y, 2 * r + 1, color);
+
+    int32_t xs = 1;
+    int32_t cx = 0;
+    int32_t r1 = r * r;
+    r++;
+    int32_t r2 = r * r;
+
+    for (int32_t cy = r - 1; cy > 0; cy--) {
+        int32_t dy2 = (r - cy) * (r - cy);
+        for (cx = xs; cx < r; cx++) {
+            int32_t hyp2 = (r - cx) * (r - cx) + dy2;
+            if (hyp2 <= r1) break;
+            if (hyp2 >= r2) continue;
+            float alphaf = (float)r - sqrtf(hyp2);
+            if (alphaf > HI_ALPHA) break;
+            xs = cx;
+            if (alphaf < LO_ALPHA) continue;
+            uint8_t alpha = alphaf * 255;
+            plotEdge(x + cx - r, y + cy - r, alpha, paint);
+            plotEdge(x - cx + r, y + cy - r, alpha, paint);
+            plotEdge(x - cx + r, y - cy + r, alpha, paint);
+            plotEdge(x + cx - r, y - cy + r, alpha, paint);
+        }
+        drawFastHLine(x + cx - r, y + cy - r, 2 * (r - cx) + 1, color);
+        drawFastHLine(x + cx - r, y - cy + r, 2 * (r - cx) + 1, color);
+    }
+}
+
+// =========================================================================
+// Push
+// =========================================================================
+void ClockSprite::push(int32_t x, int32_t y) {
+#ifdef SPI_TRACE
+    if (_bpp == 16) tracePush(x, y);
+#endif
+    switch (push_mode) {
+        case PUSH_KEYED:  pushSprite(x, y, push_key); break;
+        case PUSH_CIRCLE: pushCircle(x, y); break;
+        default:          pushPanel(x, y); break;
+    }
+}
+
+bool ClockSprite::dmaReady() const {
+    return _bpp == 16 && _tft->DMA_Enabled && esp_ptr_dma_capable(_img);
+}
+
+void ClockSprite::pushPanel(int32_t x, int32_t y) {
+    if (!dmaReady()) {
+        pushSprite(x, y);
+        return;
+    }
+    bool swap = _tft->getSwapBytes();
+    _tft->setSwapBytes(false);   // pushImageDMA() would swap the sprite in place
+    _tft->startWrite();
+    _tft->pushImageDMA(x, y, _iwidth, _iheight, _img);
+    _tft->dmaWait();             // the caller releases CS after this
+    _tft->endWrite();
+    _tft->setSwapBytes(swap);
+}
+
+// One window per row, spanning the circle plus a pixel for the AA edge.
+// The sprite has to be fully on screen. With DMA the whole frame goes out
+// in one transfer instead: 240 windows fed by the CPU would hold the bus
+// task and its core for the frame to save a fifth of the pixels.
+void ClockSprite::pushCircle(int32_t x, int32_t y) {
+    if (dmaReady()) {
+        pushPanel(x, y);
+        return;
+    }
+    if (_bpp != 16) {
+        pushSprite(x, y);
+        return;
+    }
+    bool swap = _tft->getSwapBytes();
+    _tft->setSwapBytes(false);
+    _tft->startWrite();
+    for (int32_t row = 0; row < _iheight; row++) {
+        int32_t x0, x1;
+        if (!circleSpan(row, &x0, &x1)) continue;
+        _tft->setAddrWindow(x + x0, y + row, x1 - x0, 1);
+        _tft->pushPixels(_img + row * _iwidth + x0, x1 - x0);
+    }
+    _tft->endWrite();
+    _tft->setSwapBytes(swap);
+}
+
+bool ClockSprite::circleSpan(int32_t row, int32_t* x0, int32_t* x1) const {
+    float r = min(_iwidth, _iheight) / 2.0f;
+    float cx = _iwidth / 2.0f;
+    float dy = row + 0.5f - _iheight / 2.0f;
+    if (fabsf(dy) >= r) return false;
+    float half = sqrtf(r * r - dy * dy) + 1.0f;
+    *x0 = max((int32_t)floorf(cx - half), (int32_t)0);
+    *x1 = min((int32_t)ceilf(cx + half), _iwidth);
+    return true;
+}
+
+#ifdef SPI_TRACE
+// What each push mode puts on the wire. The keyed push is TFT_eSPI's, it
+// sends a window per run of non-transparent pixels in a row.
+void ClockSprite::tracePush(int32_t x, int32_t y) {
+    switch (push_mode == PUSH_CIRCLE && dmaReady() ? PUSH_OPAQUE : push_mode) {
+        case PUSH_CIRCLE:
+            for (int32_t row = 0; row < _iheight; row++) {
+                int32_t x0, x1;
+                if (!circleSpan(row, &x0, &x1)) continue;
+                SPI_TRACE_WINDOW(0, x + x0, y + row, x1 - x0, 1);
+                SPI_TRACE_PIXELS(0, _img + row * _iwidth + x0, x1 - x0);
+            }
+            break;
+        case PUSH_KEYED: {
+            uint16_t key = panelOrder(push_key);
+            for (int32_t row = 0; row < _iheight; row++) {
+                const uint16_t* line = _img + row * _iwidth;
+                int32_t i = 0;
+                while (i < _iwidth) {
+                    while (i < _iwidth && line[i] == key) i++;
+                    int32_t start = i;
+                    while (i < _iwidth && line[i] != key) i++;
+                    if (i == start) break;
+                    SPI_TRACE_WINDOW(0, x + start, y + row, i - start, 1);
+                    SPI_TRACE_PIXELS(0, line + start, i - start);
+                }
+            }
+            break;
+        }
+        default:
+            SPI_TRACE_WINDOW(0, x, y, _iwidth, _iheight);
+            SPI_TRACE_PIXELS(0, _img, (uint32_t)_iwidth * _iheight);
+            break;
+    }
+}
+#endif
+
+// =========================================================================
+// Dial cache
+// =========================================================================
+bool ClockSprite::saveDial(uint32_t key) {
+    if (_bpp != 16 || !_created) return false;
+    uint32_t pixels = _iwidth * _iheight;
+    DialSlot* slot = nullptr;
+    for (DialSlot& s : dials) {
+        if (s.valid && s.key == key) { slot = &s; break; }
+        if (!s.valid && !slot) slot = &s;
+    }
+    if (!slot) return false;   // all taken by other keys
+    if (!slot->pixels) {
+#ifdef BOARD_HAS_PSRAM
+        slot->pixels = (uint16_t*)ps_malloc(pixels * 2);
+#endif
+        if (!slot->pixels && slot == dials) slot->pixels = (uint16_t*)malloc(pixels * 2);
+        if (!slot->pixels) return false;
+    }
+    copy565(slot->pixels, _img, pixels);
+    slot->valid = true;
+    slot->key = key;
+    slot->fill = fill_color;
+    return true;
+}
+
+bool ClockSprite::restoreDial(uint32_t key) {
+    for (DialSlot& slot : dials) {
+        if (!slot.valid || slot.key != key) continue;
+        HEAT_SCOPE(DIAL);
+        copy565(_img, slot.pixels, _iwidth * _iheight);
+        HEAT_WRITE(0, 0, _iwidth * _iheight);
+        fill_color = slot.fill;
+        return true;
+    }
+    return false;
+}
+
+void ClockSprite::clearDial() {
+    for (DialSlot& slot : dials) slot.valid = false;
+}
+
+int16_t ClockSprite::textWidth(const char* string) {
+    if (!fontLoaded) return TFT_eSprite::textWidth(string);
+
+    int32_t str_width = 0;
+    uint16_t len = strlen(string);
+    uint16_t n = 0;
+    while (n < len) {
+        uint16_t code = decodeUTF8((uint8_t*)string, &n, len - n);
+        if (!code) continue;
+        if (code == ' ') {
+            str_width += gFont.spaceWidth;
+            continue;
+        }
+        uint16_t g = 0;
+        if (!glyph_index.find(code, &g)) {
+            str_width += gFont.spaceWidth + 1;
+            continue;
+        }
+        if (str_width == 0 && gdX[g] < 0) str_width -= gdX[g];
+        // last character counts its ink, not its advance (unless digits)
+        if (n < len || isDigits) str_width += gxAdvance[g];
+        else str_width += gdX[g] + gWidth[g];
+    }
+    isDigits = false;
+    return str_width;
+}
+
+int16_t ClockSprite::drawString(const char* string, int32_t x, int32_t y) {
+    if (!fontLoaded || padX) return TFT_eSprite::drawString(string, x, y);
+    HEAT_SCOPE(TEXT);
+
+    int16_t str_width = textWidth(string);
+    int16_t str_height = gFont.yAdvance;
+    int16_t baseline = gFont.maxAscent;
+
+    switch (textdatum) {
+        case TC_DATUM:   x -= str_width / 2; break;
+        case TR_DATUM:   x -= str_width; break;
+        case ML_DATUM:   y -= str_height / 2; break;
+        case MC_DATUM:   x -= str_width / 2; y -= str_height / 2; break;
+        case MR_DATUM:   x -= str_width; y -= str_height / 2; break;
+        case BL_DATUM:   y -= str_height; break;
+        case BC_DATUM:   x -= str_width / 2; y -= str_height; break;
+        case BR_DATUM:   x -= str_width; y -= str_height; break;
+        case L_BASELINE: y -= baseline; break;
+        case C_BASELINE: x -= str_width / 2; y -= baseline; break;
+        case R_BASELINE: x -= str_width; y -= baseline; break;
+    }
+
+    setCursor(x, y);
+    uint16_t len = strlen(string);
+    uint16_t n = 0;
+    while (n < len) drawGlyph(decodeUTF8((uint8_t*)string, &n, len - n));
+    return str_width;
+}
+
+int16_t ClockSprite::drawNumber(long n, int32_t x, int32_t y) {
+    char str[12];
+    ltoa(n, str, 10);
+    isDigits = true;   // fixed width for the last digit, stops numbers jiggling
+    return drawString(str, x, y);
+}
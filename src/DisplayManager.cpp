@@ -0,0 +1,59 @@
+#include "DisplayManager.h"
+#include "SpiTrace.h"
+#include "Profiler.h"
+
+DisplayManager::DisplayManager(const Panel* panels, uint8_t count)
+    : panels(panels), count(count > MAX_PANELS ? (uint8_t)MAX_PANELS : count) {
+    for (uint8_t i = 0; i < this->count; i++) {
+        if (panels[i].bus < MAX_BUSES) bus_mask[panels[i].bus] |= 1UL << i;
+    }
+}
+
+void DisplayManager::begin() {
+    for (uint8_t i = 0; i < count; i++) {
+        pinMode(panels[i].cs_pin, OUTPUT);
+        digitalWrite(panels[i].cs_pin, HIGH);
+    }
+    for (uint8_t b = 0; b < MAX_BUSES; b++) selected[b] = 0;
+    buildGroups();
+}
+
+// CS is active low, only the pins that change are written. Panels on
+// other buses are left alone.
+void DisplayManager::select(uint32_t mask, uint8_t bus) {
+    mask &= bus_mask[bus];
+    uint32_t changed = mask ^ selected[bus];
+    if (changed) {
+        SPI_TRACE_SELECT(bus, mask);
+        TIMELINE_MARK(EVENT_SELECT0 + bus, mask);
+    }
+    for (uint8_t i = 0; changed; i++, changed >>= 1) {
+        if (changed & 1) digitalWrite(panels[i].cs_pin, (mask & (1UL << i)) ? LOW : HIGH);
+    }
+    selected[bus] = mask;
+}
+
+static bool sameZone(const char* a, const char* b) {
+    return a == b || (a && b && !strcmp(a, b));
+}
+
+void DisplayManager::buildGroups() {
+    group_count = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        const Panel& p = panels[i];
+        if (p.bus >= MAX_BUSES) continue;
+        bool joined = false;
+        if (p.mirrored) {
+            for (uint8_t g = 0; g < group_count; g++) {
+                const Panel& first = panels[groups[g].first];
+                if (first.mirrored && first.bus == p.bus && first.face == p.face && first.bg_color == p.bg_color
+                    && first.canvas_x == p.canvas_x && first.canvas_y == p.canvas_y && sameZone(first.tz, p.tz)) {
+                    groups[g].mask |= 1UL << i;
+                    joined = true;
+                    break;
+                }
+            }
+        }
+        if (!joined) groups[group_count++] = {(uint32_t)(1UL << i), i, p.bus};
+    }
+}
@@ -0,0 +1,94 @@
+#include "Faces.h"
+
+// =========================================================================
+// Get coordinates of end of a line, pivot at x,y, length r, angle a
+// =========================================================================
+// Coordinates are returned to caller via the xp and yp pointers, the
+// angle is a fraction of a turn clockwise from 12 (see ClockTime.h)
+void getCoord(int16_t x, int16_t y, float *xp, float *yp, int16_t r, turn_t a)
+{
+  *xp = x + r * sinTurn(a) * (1.0f / 32767);
+  *yp = y - r * cosTurn(a) * (1.0f / 32767);
+}
+
+// =========================================================================
+// Draw the clock face in the sprite
+// =========================================================================
+void drawAnalogFace(ClockSprite& face, day_us_t t, uint16_t bg_color) {
+  turn_t h_angle = handTurn(t, HOUR_PERIOD);
+  turn_t m_angle = handTurn(t, MINUTE_PERIOD);
+  turn_t s_angle = handTurn(t, SECOND_PERIOD);
+
+  float xp = 0.0, yp = 0.0; // Use float pixel position for smooth AA motion
+
+  // The face is completely redrawn each frame. The dial (background and
+  // numerals) only depends on the background colour, so it is drawn once per
+  // background and copied in from the dial cache after that.
+  if (!face.restoreDial(bg_color)) {
+    face.fillSprite(bg_color);
+
+    // Set text datum to middle centre and the colour
+    face.setTextDatum(MC_DATUM);
+
+    // Numerals sit on the flat background, so their edges come from a
+    // colour ramp for this fg/bg pair (see setKnownBackground)
+    face.setTextColor(CLOCK_FG, bg_color);
+
+    // Text offset adjustment
+    constexpr uint32_t dialOffset = CLOCK_R - 15;
+
+    // Draw digits around clock perimeter
+    for (uint32_t h = 1; h <= 12; h++) {
+      getCoord(CLOCK_R, CLOCK_R, &xp, &yp, dialOffset, TURN(h, 12));
+      face.drawNumber(h, xp, 2 + yp);
+    }
+    face.saveDial(bg_color);
+  }
+
+  // Add text (could be digital time...)
+  face.setTextColor(LABEL_FG, bg_color);
+  //face.drawString("TFT_eSPI", CLOCK_R, CLOCK_R * 0.75);
+
+  // Draw minute hand
+  getCoord(CLOCK_R, CLOCK_R, &xp, &yp, M_HAND_LENGTH, m_angle);
+  face.drawWideLine(CLOCK_R, CLOCK_R, xp, yp, 8.0f, CLOCK_FG);
+  face.drawWideLine(CLOCK_R, CLOCK_R, xp, yp, 4.0f, TFT_GREEN);
+
+  // Draw hour hand
+  getCoord(CLOCK_R, CLOCK_R, &xp, &yp, H_HAND_LENGTH, h_angle);
+  face.drawWideLine(CLOCK_R, CLOCK_R, xp, yp, 8.0f, CLOCK_FG);
+  face.drawWideLine(CLOCK_R, CLOCK_R, xp, yp, 4.0f, TFT_GREENYELLOW);
+
+  // Draw the central pivot circle
+  face.fillSmoothCircle(CLOCK_R, CLOCK_R, 8, CLOCK_FG);
+
+  // Draw second hand
+  getCoord(CLOCK_R, CLOCK_R, &xp, &yp, S_HAND_LENGTH, s_angle);
+  face.drawWedgeLine(CLOCK_R, CLOCK_R, xp, yp, 3.5, 1.5, SECCOND_FG);
+}
+
+// =========================================================================
+// Draw the digital face, hours and minutes in sprites of their own
+// =========================================================================
+void drawDigitalHours(ClockSprite& hours, int hr, uint16_t bg_color) {
+  char cnum[10];
+  hours.fillSprite(bg_color);
+  hours.setTextColor(CLOCK_FG, bg_color);
+  hours.setTextDatum(MR_DATUM);
+  snprintf(cnum, 10, "%02d", hr);  // hours
+  hours.drawString(cnum, hours.width()-2, hours.height()/2);
+}
+
+void drawDigitalMinutes(ClockSprite& minutes, day_us_t t, uint16_t bg_color) {
+  char cnum[10];
+  minutes.fillSprite(bg_color);
+  minutes.setTextColor(TFT_ORANGE, bg_color);
+  minutes.setTextDatum(ML_DATUM);
+  // minutes
+  snprintf(cnum, 10, "%02d", (int)(t / US_PER_MIN % 60));
+  minutes.drawString(cnum, 0, minutes.height()*0.3);
+  minutes.setTextColor(TFT_SKYBLUE, bg_color);
+  // seconds
+  snprintf(cnum, 10, "%02d", (int)(t / US_PER_SEC % 60));
+  minutes.drawString(cnum, 0, minutes.height()*0.7);
+}
@@ -0,0 +1,32 @@
+#include "GlyphIndex.h"
+#include <algorithm>
+
+void GlyphIndex::build(const uint16_t* unicode, uint16_t glyph_count) {
+    clear();
+    for (uint16_t i = 0; i < glyph_count; i++) {
+        uint16_t code = unicode[i];
+        if (code < ASCII_SIZE) {
+            // keep the first match, same as the library's linear scan
+            if (ascii[code] == NO_GLYPH) ascii[code] = i;
+        } else {
+            others.push_back({code, i});
+        }
+    }
+    std::stable_sort(others.begin(), others.end(),
+        [](const Entry& a, const Entry& b) { return a.code < b.code; });
+    count = glyph_count;
+}
+
+void GlyphIndex::clear() {
+    for (uint16_t i = 0; i < ASCII_SIZE; i++) ascii[i] = NO_GLYPH;
+    others.clear();
+    count = 0;
+}
+
+bool GlyphIndex::findOther(uint16_t code, uint16_t* index) const {
+    auto it = std::lower_bound(others.begin(), others.end(), code,
+        [](const Entry& e, uint16_t c) { return e.code < c; });
+    if (it == others.end() || it->code != code) return false;
+    *index = it->index;
+    return true;
+}
@@ -0,0 +1,65 @@
+#include "GoldenFrames.h"
+#include "Pixel565.h"
+
+// The faces only see local time in seconds since midnight, the DST edges
+// are the times either side of the jump
+#define HMS(h, m, s) ((h)*US_PER_HOUR + (m)*US_PER_MIN + (s)*US_PER_SEC)
+const GoldenTime golden_times[] = {
+  {"midnight",       0},
+  {"12-59-59",       HMS(12, 59, 59)},
+  {"13-00-00",       HMS(13, 0, 0)},
+  {"dst-spring-pre", HMS(1, 59, 59)},   // 01:59:59 goes to 03:00:00
+  {"dst-spring",     HMS(3, 0, 0)},
+  {"dst-fall-pre",   HMS(2, 59, 59)},   // 02:59:59 goes back to 02:00:00
+  {"dst-fall",       HMS(2, 0, 0)},
+  {"frac-0.25",      HMS(10, 8, 42) + 250000},
+  {"frac-0.50",      HMS(10, 8, 42) + 500000},
+  {"frac-0.75",      HMS(10, 8, 42) + 750000},
+  {"23-59-59.99",    HMS(23, 59, 59) + 990000},
+};
+const uint8_t GOLDEN_TIMES = sizeof(golden_times) / sizeof(golden_times[0]);
+
+const char* goldenFaceName(GoldenFace face) {
+  return face == GOLDEN_ANALOG ? "analog" : "digital";
+}
+
+static void blit(ClockSprite& dst, ClockSprite& src, int16_t x, int16_t y) {
+  uint16_t* d = (uint16_t*)dst.getPointer();
+  const uint16_t* p = (const uint16_t*)src.getPointer();
+  for (int16_t row = 0; row < src.height(); row++){
+    copy565(d + (y + row) * dst.width() + x, p + row * src.width(), src.width());
+  }
+}
+
+void drawGoldenFrame(ClockSprite& fb, ClockSprite& hours, ClockSprite& minutes, GoldenFace face, day_us_t t) {
+  if (face == GOLDEN_ANALOG){
+    drawAnalogFace(fb, t, TFT_DARKGREEN);
+    return;
+  }
+  fb.fillSprite(TFT_BLACK);
+  fb.fillSmoothCircle(CLOCK_R-1, CLOCK_R-1, CLOCK_R, TFT_BLUE);
+  drawDigitalHours(hours, t / US_PER_HOUR, TFT_BLUE);
+  drawDigitalMinutes(minutes, t, TFT_BLUE);
+  blit(fb, hours, HOURS_X, DIGITS_Y);
+  blit(fb, minutes, MINUTES_X, DIGITS_Y);
+}
+
+void dumpFrame(Print& out, const char* face, const char* name, ClockSprite& fb) {
+  const uint16_t* px = (const uint16_t*)fb.getPointer();
+  uint32_t count = (uint32_t)fb.width() * fb.height();
+  for (int pass = 0; pass < 2; pass++){
+    uint32_t runs = 0;
+    for (uint32_t i = 0; i < count; runs++){
+      uint16_t color = px[i];
+      uint32_t n = 1;
+      while (i + n < count && n < 0xFFFF && px[i + n] == color) n++;
+      if (pass){
+        uint8_t run[4] = {(uint8_t)n, (uint8_t)(n >> 8), (uint8_t)color, (uint8_t)(color >> 8)};
+        out.write(run, 4);
+      }
+      i += n;
+    }
+    if (!pass) out.printf("\nGOLDEN %s-%s %d %d %u\n", face, name, fb.width(), fb.height(), (unsigned)(runs * 4));
+  }
+  out.flush();
+}
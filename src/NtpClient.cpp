@@ -0,0 +1,227 @@
+#include "NtpClient.h"
+#include "Cores.h"
+#include <sys/time.h>
+#include "Profiler.h"
+
+#define NTP_PORT        123
+#define NTP_PACKET      48
+#define NTP_UNIX_DELTA  2208988800UL   // 1900 to 1970
+
+static int64_t nowUs() {
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// 32.32 fixed point seconds since 1900, the seconds wrap in 2036 and are
+// taken as the era after it then
+static void writeTimestamp(uint8_t* p, int64_t us) {
+    uint32_t sec = (uint32_t)(us / 1000000) + NTP_UNIX_DELTA;
+    uint32_t frac = (uint32_t)(((uint64_t)(us % 1000000) << 32) / 1000000);
+    for (int i = 0; i < 4; i++) {
+        p[i] = sec >> (24 - 8 * i);
+        p[4 + i] = frac >> (24 - 8 * i);
+    }
+}
+
+static int64_t readTimestamp(const uint8_t* p) {
+    uint32_t sec = 0, frac = 0;
+    for (int i = 0; i < 4; i++) {
+        sec = sec << 8 | p[i];
+        frac = frac << 8 | p[4 + i];
+    }
+    return (int64_t)(uint32_t)(sec - NTP_UNIX_DELTA) * 1000000 + (((uint64_t)frac * 1000000) >> 32);
+}
+
+NtpClient::NtpClient(const char* const* list, uint8_t n, ClockDiscipline* clock) : clock(clock) {
+    for (uint8_t i = 0; i < n && count < MAX_SERVERS; i++) {
+        Server& server = servers[count++];
+        server = {};
+        snprintf(server.host, sizeof(server.host), "%s", list[i]);
+        server.port = NTP_PORT;
+        char* colon = strchr(server.host, ':');
+        if (colon) {
+            *colon = 0;
+            server.port = atoi(colon + 1);
+        }
+    }
+}
+
+// One request, keeps its offset if its round trip is the shortest so far
+NtpClient::Reply NtpClient::request(Server& server) {
+    uint8_t packet[NTP_PACKET] = {};
+    uint8_t sent[8];
+    packet[0] = 0x23;   // no leap warning, version 4, client
+    int64_t t1 = nowUs();
+    writeTimestamp(packet + 40, t1);
+    memcpy(sent, packet + 40, 8);
+
+    while (udp.parsePacket() > 0) {}   // late replies to earlier requests
+    if (!udp.beginPacket(server.ip, server.port) || udp.write(packet, NTP_PACKET) != NTP_PACKET || !udp.endPacket()) {
+        return REPLY_NONE;
+    }
+    uint32_t start = millis();
+    while (millis() - start < TIMEOUT_MS) {
+        if (udp.parsePacket() >= NTP_PACKET) {
+            int64_t t4 = nowUs();
+            udp.read(packet, NTP_PACKET);
+            // the server echoes our transmit time, anything else is stale
+            if (memcmp(packet + 24, sent, 8) != 0) continue;
+            uint8_t leap = packet[0] >> 6, mode = packet[0] & 7, stratum = packet[1];
+            if (mode != 4) return REPLY_NONE;
+            // stratum 0 is a kiss-o'-death, the reference id says why
+            if (stratum == 0) {
+                bool deny = memcmp(packet + 12, "DENY", 4) == 0 || memcmp(packet + 12, "RSTR", 4) == 0;
+                return deny ? REPLY_DENY : REPLY_RATE;
+            }
+            if (leap == 3 || stratum > 15) return REPLY_NONE;   // unsynchronised
+            int64_t t2 = readTimestamp(packet + 32);
+            int64_t t3 = readTimestamp(packet + 40);
+            int64_t offset = ((t2 - t1) + (t3 - t4)) / 2;
+            int64_t delay = max((int64_t)0, (t4 - t1) - (t3 - t2));
+            if (!server.answered || delay < server.delay_us) {
+                server.offset_us = offset;
+                server.delay_us = delay;
+            }
+            server.answered = true;
+            return REPLY_TIME;
+        }
+        // spinning catches a LAN reply to the microsecond, a tick of sleep
+        // would add up to a millisecond to its round trip
+        if (millis() - start < SPIN_MS) yield();
+        else vTaskDelay(1);
+    }
+    return REPLY_NONE;
+}
+
+void NtpClient::kissed(Server& server, Reply reply) {
+    if (reply == REPLY_DENY) server.backoff = MAX_BACKOFF;
+    else if (reply == REPLY_RATE) server.backoff = server.backoff ? min(server.backoff * 2, (int)MAX_BACKOFF) : 1;
+    else return;
+    server.skip = server.backoff;
+}
+
+bool NtpClient::combine(Stats* out) {
+    Server* sorted[MAX_SERVERS];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (!servers[i].answered) continue;
+        // by offset
+        uint8_t j = n++;
+        for (; j > 0 && sorted[j - 1]->offset_us > servers[i].offset_us; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = &servers[i];
+    }
+    *out = {};
+    out->answered = n;
+    if (!n) return false;
+
+    // the median, the faster of the middle two for an even count
+    Server* ref = sorted[(n - 1) / 2];
+    if (n % 2 == 0 && sorted[n / 2]->delay_us < ref->delay_us) ref = sorted[n / 2];
+
+    // the true offset is within half the round trip of a good reading
+    double sum = 0, weights = 0;
+    out->delay_us = UINT32_MAX;
+    for (uint8_t i = 0; i < n; i++) {
+        Server* s = sorted[i];
+        if (llabs(s->offset_us - ref->offset_us) > s->delay_us / 2 + MARGIN_US) continue;
+        double d = max(s->delay_us, (int64_t)500);
+        sum += s->offset_us / (d * d);
+        weights += 1 / (d * d);
+        out->delay_us = min(out->delay_us, (uint32_t)s->delay_us);
+        out->used++;
+    }
+    out->offset_us = (int64_t)(sum / weights);
+
+    double spread = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        Server* s = sorted[i];
+        if (llabs(s->offset_us - ref->offset_us) > s->delay_us / 2 + MARGIN_US) continue;
+        spread += (double)(s->offset_us - out->offset_us) * (s->offset_us - out->offset_us);
+    }
+    out->jitter_us = (uint32_t)sqrt(spread / out->used);
+    return true;
+}
+
+bool NtpClient::sync() {
+    if (!WiFi.isConnected() || !count) return false;
+    if (!udp_open) udp_open = udp.begin(0);   // any local port
+    if (!udp_open) return false;
+
+    // names again each time, pools hand out other servers
+    bool asking[MAX_SERVERS];
+    uint8_t backed_off = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        Server& server = servers[i];
+        server.answered = false;
+        asking[i] = false;
+        if (server.skip) {
+            server.skip--;
+            backed_off++;
+            continue;
+        }
+        asking[i] = WiFi.hostByName(server.host, server.ip) == 1;
+    }
+    uint8_t rounds = settled ? 1 : BURST;
+    for (uint8_t round = 0; round < rounds; round++) {
+        // public servers don't like more than one request a second, also
+        // when a failed first sync is retried right away
+        uint32_t since = millis() - last_round_ms;
+        if (since < 1000) delay(1000 - since);
+        last_round_ms = millis();
+        for (uint8_t i = 0; i < count; i++) {
+            if (!asking[i]) continue;
+            Reply reply = request(servers[i]);
+            if (reply == REPLY_TIME) {
+                servers[i].backoff /= 2;
+            } else if (reply != REPLY_NONE) {
+                kissed(servers[i], reply);
+                asking[i] = false;
+                backed_off++;
+            }
+        }
+    }
+
+    Stats result;
+    if (!combine(&result)) return false;
+    settled = true;
+    result.backed_off = backed_off;
+    if (!clock->correct(result.offset_us)) return false;
+    result.stepped = clock->stepped();
+    result.drift_ppm = clock->drift();
+    {
+        std::lock_guard<std::mutex> guard(last_lock);
+        last = result;
+    }
+    sync_count++;
+    TIMELINE_MARK(EVENT_NTP_SYNC, result.used);
+    return true;
+}
+
+NtpClient::Stats NtpClient::stats() const {
+    std::lock_guard<std::mutex> guard(last_lock);
+    return last;
+}
+
+void NtpClient::printStats() const {
+    Stats shown = stats();
+    Serial.printf("NTP offset %+lld us (%s), jitter %u us, delay %u us, %u of %u servers, drift %+.2f ppm",
+                  (long long)shown.offset_us, shown.stepped ? "stepped" : "slewed", (unsigned)shown.jitter_us,
+                  (unsigned)shown.delay_us, shown.used, shown.answered, (double)shown.drift_ppm);
+    if (shown.backed_off) Serial.printf(", %u backed off", shown.backed_off);
+    Serial.println();
+}
+
+bool NtpClient::start(uint32_t poll_s) {
+    this->poll_s = poll_s;
+    return xTaskCreatePinnedToCore(taskMain, "ntp", 4096, this, 1, nullptr, otherCore()) == pdPASS;
+}
+
+void NtpClient::taskMain(void* arg) {
+    NtpClient* ntp = (NtpClient*)arg;
+    for (;;) {
+        // a failed poll waits for the next one, the drift keeps the clock close
+        vTaskDelay(pdMS_TO_TICKS(ntp->poll_s * 1000));
+        ntp->sync();
+    }
+}
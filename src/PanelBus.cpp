@@ -0,0 +1,320 @@
+#include "PanelBus.h"
+#include "Cores.h"
+#include "Pixel565.h"
+#include "SpiTrace.h"
+#include "Profiler.h"
+
+bool PanelBus::start(DisplayManager* displays, const char* name) {
+    this->displays = displays;
+    queue = xQueueCreate(4, sizeof(Job));
+    if (!queue) return false;
+    if (xTaskCreatePinnedToCore(taskMain, name, 4096, this, 2, nullptr, otherCore()) != pdPASS) {
+        vQueueDelete(queue);
+        queue = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void PushLatency::sent() {
+    uint32_t sample = micros() - read_at;
+    if (sample > MAX_US) return;
+    uint32_t a = avg.load();
+    // 1/8 of the way to each sample, the first one as is
+    avg = a ? (uint32_t)((int32_t)a + ((int32_t)sample - (int32_t)a) / 8) : sample;
+}
+
+void PanelBus::submit(ClockSprite* sprite, int16_t x, int16_t y, const PanelGroup& group,
+                      std::atomic<int>* done, bool first) {
+    send({sprite, x, y, group, done, nullptr}, first);
+}
+
+void PanelBus::submitFrame(ClockSprite* sprite, int16_t x, int16_t y, const PanelGroup& group,
+                           PushLatency* latency) {
+    send({sprite, x, y, group, nullptr, latency}, false);
+}
+
+// Without a task (before start(), or if it failed) the push is done here
+void PanelBus::send(const Job& job, bool first) {
+    if (!queue) {
+        {
+            PROFILE_ZONE(ZONE_PUSH0 + job.group.bus);
+            push(job);
+        }
+        if (job.latency) job.latency->sent();
+        return;
+    }
+    pending++;
+    if (job.done) (*job.done)++;
+    if (first) xQueueSendToFront(queue, &job, portMAX_DELAY);
+    else xQueueSend(queue, &job, portMAX_DELAY);
+}
+
+void PanelBus::wait() {
+    PROFILE_ZONE(ZONE_WAIT);
+    waiter = xTaskGetCurrentTaskHandle();
+    while (pending.load()) ulTaskNotifyTake(pdTRUE, 1);
+    waiter = nullptr;
+}
+
+void PanelBus::taskMain(void* arg) {
+    PanelBus* bus = (PanelBus*)arg;
+    Job job;
+    for (;;) {
+        if (xQueueReceive(bus->queue, &job, portMAX_DELAY) != pdTRUE) continue;
+        {
+            PROFILE_ZONE(ZONE_PUSH0 + job.group.bus);
+            bus->push(job);
+        }
+        if (job.done) (*job.done)--;
+        if (job.latency) job.latency->sent();
+        TaskHandle_t waiter = bus->waiter;
+        if (--bus->pending == 0 && waiter) xTaskNotifyGive(waiter);
+    }
+}
+
+void TftPanelBus::push(const Job& job) {
+    displays->pushGroup(job.group, [&]{ job.sprite->push(job.x, job.y); });
+}
+
+#if __has_include(<driver/spi_master.h>)
+#include <driver/gpio.h>
+#include <esp_heap_caps.h>
+#if __has_include(<esp_idf_version.h>)
+#include <esp_idf_version.h>
+#endif
+#if __has_include(<esp_memory_utils.h>)
+#include <esp_memory_utils.h>
+#else
+#include <soc/soc_memory_layout.h>
+#endif
+
+// GC9A01 power-up sequence, the same one TFT_eSPI sends, with MADCTL for
+// rotation 0. Entries are command, data length, data. A length with
+// INIT_DELAY set is followed by a delay in ms after the data.
+#define INIT_DELAY 0x80
+static const uint8_t gc9a01_init[] = {
+    0xEF, 0,
+    0xEB, 1, 0x14,
+    0xFE, 0,
+    0xEF, 0,
+    0xEB, 1, 0x14,
+    0x84, 1, 0x40,
+    0x85, 1, 0xFF,
+    0x86, 1, 0xFF,
+    0x87, 1, 0xFF,
+    0x88, 1, 0x0A,
+    0x89, 1, 0x21,
+    0x8A, 1, 0x00,
+    0x8B, 1, 0x80,
+    0x8C, 1, 0x01,
+    0x8D, 1, 0x01,
+    0x8E, 1, 0xFF,
+    0x8F, 1, 0xFF,
+    0xB6, 2, 0x00, 0x00,
+    0x36, 1, 0x08,
+    0x3A, 1, 0x05,
+    0x90, 4, 0x08, 0x08, 0x08, 0x08,
+    0xBD, 1, 0x06,
+    0xBC, 1, 0x00,
+    0xFF, 3, 0x60, 0x01, 0x04,
+    0xC3, 1, 0x13,
+    0xC4, 1, 0x13,
+    0xC9, 1, 0x22,
+    0xBE, 1, 0x11,
+    0xE1, 2, 0x10, 0x0E,
+    0xDF, 3, 0x21, 0x0C, 0x02,
+    0xF0, 6, 0x45, 0x09, 0x08, 0x08, 0x26, 0x2A,
+    0xF1, 6, 0x43, 0x70, 0x72, 0x36, 0x37, 0x6F,
+    0xF2, 6, 0x45, 0x09, 0x08, 0x08, 0x26, 0x2A,
+    0xF3, 6, 0x43, 0x70, 0x72, 0x36, 0x37, 0x6F,
+    0xED, 2, 0x1B, 0x0B,
+    0xAE, 1, 0x77,
+    0xCD, 1, 0x63,
+    0x70, 9, 0x07, 0x07, 0x04, 0x0E, 0x0F, 0x09, 0x07, 0x08, 0x03,
+    0xE8, 1, 0x34,
+    0x62, 12, 0x18, 0x0D, 0x71, 0xED, 0x70, 0x70, 0x18, 0x0F, 0x71, 0xEF, 0x70, 0x70,
+    0x63, 12, 0x18, 0x11, 0x71, 0xF1, 0x70, 0x70, 0x18, 0x13, 0x71, 0xF3, 0x70, 0x70,
+    0x64, 7, 0x28, 0x29, 0xF1, 0x01, 0xF1, 0x00, 0x07,
+    0x66, 10, 0x3C, 0x00, 0xCD, 0x67, 0x45, 0x45, 0x10, 0x00, 0x00, 0x00,
+    0x67, 10, 0x00, 0x3C, 0x00, 0x00, 0x00, 0x01, 0x54, 0x10, 0x32, 0x98,
+    0x74, 7, 0x10, 0x85, 0x80, 0x00, 0x00, 0x4E, 0x00,
+    0x98, 2, 0x3E, 0x07,
+    0x35, 0,
+    0x21, 0,
+    0x11, INIT_DELAY, 120,
+    0x29, INIT_DELAY, 20,
+};
+
+// DC pin and level ride along in the transaction's user field
+static inline void* dcUser(int pin, int level) {
+    return (void*)(uintptr_t)((pin << 1) | level);
+}
+
+static void IRAM_ATTR setDC(spi_transaction_t* t) {
+    uint32_t user = (uint32_t)(uintptr_t)t->user;
+    gpio_set_level((gpio_num_t)(user >> 1), user & 1);
+}
+
+bool SpiPanelBus::begin(DisplayManager* displays, uint8_t bus, spi_host_device_t host,
+                        int mosi, int sclk, int dc, int rst, uint32_t freq) {
+    this->displays = displays;
+    this->bus = bus;
+    dc_pin = dc;
+    rst_pin = rst;
+
+    for (uint8_t i = 0; i < 2; i++) {
+        bounce[i] = (uint8_t*)heap_caps_malloc(CHUNK_BYTES, MALLOC_CAP_DMA);
+        if (!bounce[i]) return false;
+    }
+
+    spi_bus_config_t cfg = {};
+    cfg.mosi_io_num = mosi;
+    cfg.miso_io_num = -1;
+    cfg.sclk_io_num = sclk;
+    cfg.quadwp_io_num = -1;
+    cfg.quadhd_io_num = -1;
+    cfg.max_transfer_sz = CHUNK_BYTES;
+    // DMA channel 1 is TFT_eSPI's
+#if ESP_IDF_VERSION_MAJOR >= 4
+    if (spi_bus_initialize(host, &cfg, (spi_dma_chan_t)2) != ESP_OK) return false;
+#else
+    if (spi_bus_initialize(host, &cfg, 2) != ESP_OK) return false;
+#endif
+
+    spi_device_interface_config_t dev = {};
+    dev.clock_speed_hz = freq;
+    dev.mode = 0;
+    dev.spics_io_num = -1;     // CS is DisplayManager's
+    dev.queue_size = 2;
+    dev.pre_cb = setDC;
+    if (spi_bus_add_device(host, &dev, &device) != ESP_OK) return false;
+
+    pinMode(dc_pin, OUTPUT);
+    if (rst_pin >= 0) {
+        pinMode(rst_pin, OUTPUT);
+        digitalWrite(rst_pin, HIGH);
+        delay(5);
+        digitalWrite(rst_pin, LOW);
+        delay(20);
+        digitalWrite(rst_pin, HIGH);
+        delay(150);
+    }
+    initPanels();
+    return true;
+}
+
+// All the bus's panels at once, like tft.init() on the main bus
+void SpiPanelBus::initPanels() {
+    displays->selectAll(bus);
+    const uint8_t* p = gc9a01_init;
+    while (p < gc9a01_init + sizeof(gc9a01_init)) {
+        uint8_t cmd = *p++;
+        uint8_t len = *p++;
+        uint8_t wait_ms = 0;
+        if (len & INIT_DELAY) {
+            len &= ~INIT_DELAY;
+            SPI_TRACE_COMMAND(bus, cmd, p, len);
+            command(cmd, p, len);
+            wait_ms = p[len];
+            p += len + 1;
+        } else {
+            SPI_TRACE_COMMAND(bus, cmd, p, len);
+            command(cmd, p, len);
+            p += len;
+        }
+        if (wait_ms) delay(wait_ms);
+    }
+    setWindow(0, 0, TFT_WIDTH, TFT_HEIGHT);
+    fillPixels(TFT_BLACK, (uint32_t)TFT_WIDTH * TFT_HEIGHT);
+    displays->release(bus);
+}
+
+// Only used with nothing queued, so the bounce buffers are free
+void SpiPanelBus::command(uint8_t cmd, const uint8_t* data, uint8_t len) {
+    spi_transaction_t t = {};
+    t.flags = SPI_TRANS_USE_TXDATA;
+    t.length = 8;
+    t.tx_data[0] = cmd;
+    t.user = dcUser(dc_pin, 0);
+    spi_device_transmit(device, &t);
+    if (!len) return;
+
+    t = {};
+    t.length = len * 8;
+    t.user = dcUser(dc_pin, 1);
+    if (len <= 4) {
+        t.flags = SPI_TRANS_USE_TXDATA;
+        memcpy(t.tx_data, data, len);
+    } else {
+        memcpy(bounce[0], data, len);
+        t.tx_buffer = bounce[0];
+    }
+    spi_device_transmit(device, &t);
+}
+
+void SpiPanelBus::setWindow(int16_t x, int16_t y, int16_t w, int16_t h) {
+    int16_t x1 = x + w - 1;
+    int16_t y1 = y + h - 1;
+    uint8_t cols[4] = {(uint8_t)(x >> 8), (uint8_t)x, (uint8_t)(x1 >> 8), (uint8_t)x1};
+    uint8_t rows[4] = {(uint8_t)(y >> 8), (uint8_t)y, (uint8_t)(y1 >> 8), (uint8_t)y1};
+    SPI_TRACE_WINDOW(bus, x, y, w, h);
+    command(0x2A, cols, 4);   // CASET
+    command(0x2B, rows, 4);   // RASET
+    command(0x2C);            // RAMWR
+}
+
+// Pixels are in panel order already. Up to two chunks are on the wire, a
+// chunk's buffer is only refilled once its transaction has come back.
+void SpiPanelBus::sendPixels(const uint16_t* pixels, uint32_t count) {
+    SPI_TRACE_PIXELS(bus, pixels, count);
+    const uint8_t* src = (const uint8_t*)pixels;
+    uint32_t remaining = count * 2;
+    bool direct = esp_ptr_dma_capable(pixels) && ((uintptr_t)pixels & 3) == 0;
+    uint8_t slot = 0;
+    uint8_t in_flight = 0;
+    spi_transaction_t* done;
+
+    while (remaining) {
+        if (in_flight == 2) {
+            spi_device_get_trans_result(device, &done, portMAX_DELAY);
+            in_flight--;
+        }
+        uint32_t n = remaining < CHUNK_BYTES ? remaining : CHUNK_BYTES;
+        const uint8_t* buf = src;
+        if (!direct) {
+            copy565((uint16_t*)bounce[slot], (const uint16_t*)src, n / 2);
+            buf = bounce[slot];
+        }
+        spi_transaction_t& t = trans[slot];
+        t = {};
+        t.length = n * 8;
+        t.tx_buffer = buf;
+        t.user = dcUser(dc_pin, 1);
+        spi_device_queue_trans(device, &t, portMAX_DELAY);
+        in_flight++;
+        slot ^= 1;
+        src += n;
+        remaining -= n;
+    }
+    while (in_flight--) spi_device_get_trans_result(device, &done, portMAX_DELAY);
+}
+
+void SpiPanelBus::fillPixels(uint16_t color, uint32_t count) {
+    const uint32_t chunk = CHUNK_BYTES / 2;
+    fill565((uint16_t*)bounce[1], panelOrder(color), chunk);
+    while (count) {
+        uint32_t n = count < chunk ? count : chunk;
+        sendPixels((const uint16_t*)bounce[1], n);
+        count -= n;
+    }
+}
+
+void SpiPanelBus::push(const Job& job) {
+    ClockSprite& sprite = *job.sprite;
+    displays->pushGroup(job.group, [&]{
+        setWindow(job.x, job.y, sprite.width(), sprite.height());
+        sendPixels((const uint16_t*)sprite.getPointer(), (uint32_t)sprite.width() * sprite.height());
+    });
+}
+#endif
@@ -0,0 +1,235 @@
+#include "PeerSync.h"
+#include "Cores.h"
+
+#ifdef PEER_SYNC
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+static int64_t nowUs() {
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int openSocket(uint16_t port, bool shared) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    // all the clocks on a host share the beacon port
+    if (shared) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool PeerSync::begin(uint32_t id, uint32_t iface) {
+    this->id = id;
+    group_fd = openSocket(PEER_SYNC, true);
+    fd = openSocket(0, false);
+    if (group_fd < 0 || fd < 0) return false;
+
+    ip_mreq mreq = {};
+    mreq.imr_multiaddr.s_addr = inet_addr(PEER_GROUP);
+    mreq.imr_interface.s_addr = iface;
+    if (setsockopt(group_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) return false;
+    if (iface) {
+        in_addr out = {};
+        out.s_addr = iface;
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &out, sizeof(out));
+    }
+    uint8_t ttl = 1;   // this LAN only
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+    sockaddr_in addr = {};
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    port = ntohs(addr.sin_port);
+    leader.id = id;
+    last.leader = id;
+    return true;
+}
+
+uint8_t PeerSync::rank() const {
+    return clock->syncedBy(ClockDiscipline::SOURCE_NTP) ? 0 : 1;
+}
+
+void PeerSync::send(Packet& packet, uint32_t ip, uint16_t to_port) {
+    memcpy(packet.magic, "CLKP", 4);
+    packet.rank = rank();
+    packet.port = port;
+    packet.id = id;
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(to_port);
+    addr.sin_addr.s_addr = ip;
+    sendto(fd, &packet, sizeof(packet), 0, (sockaddr*)&addr, sizeof(addr));
+}
+
+void PeerSync::heard(const Packet& packet, uint32_t ip) {
+    Peer* peer = nullptr;
+    for (uint8_t i = 0; i < peer_count && !peer; i++) {
+        if (peers[i].id == packet.id) peer = &peers[i];
+    }
+    if (!peer) {
+        if (peer_count == MAX_PEERS) return;
+        peer = &peers[peer_count++];
+        peer->id = packet.id;
+    }
+    peer->ip = ip;
+    peer->port = packet.port;
+    peer->rank = packet.rank;
+    peer->seen_ms = millis();
+}
+
+void PeerSync::chooseLeader() {
+    uint32_t now = millis();
+    Peer best = {id, 0, port, rank(), now};
+    uint8_t alive = 0;
+    for (uint8_t i = 0; i < peer_count; i++) {
+        if (now - peers[i].seen_ms > LOST_MS) {
+            peers[i--] = peers[--peer_count];
+            continue;
+        }
+        alive++;
+        const Peer& p = peers[i];
+        if (p.rank < best.rank || (p.rank == best.rank && p.id < best.id)) best = p;
+    }
+    {
+        std::lock_guard<std::mutex> guard(last_lock);
+        last.peers = alive;
+        if (best.id != leader.id) last.leader = best.id;
+    }
+    if (best.id != leader.id) {
+        change_count++;
+        // measure the new one right away
+        last_poll = now - POLL_MS;
+    }
+    leader = best;
+    clock->follow(leading() ? ClockDiscipline::SOURCE_NTP : ClockDiscipline::SOURCE_PEER);
+}
+
+void PeerSync::handle(int from_fd) {
+    Packet packet;
+    sockaddr_in addr = {};
+    socklen_t len = sizeof(addr);
+    int n = recvfrom(from_fd, &packet, sizeof(packet), 0, (sockaddr*)&addr, &len);
+    int64_t received = nowUs();
+    if (n != sizeof(packet) || memcmp(packet.magic, "CLKP", 4) != 0 || packet.id == id) return;
+
+    switch (packet.type) {
+        case BEACON:
+            heard(packet, addr.sin_addr.s_addr);
+            break;
+        case REQUEST: {
+            // anyone asking gets an answer, it may know of a leader change first
+            Packet reply = {};
+            reply.type = REPLY;
+            reply.t1 = packet.t1;
+            reply.t2 = received;
+            reply.t3 = nowUs();
+            send(reply, addr.sin_addr.s_addr, packet.port);
+            break;
+        }
+        case REPLY: {
+            if (packet.t1 != pending_t1 || packet.id != leader.id) break;
+            int64_t t4 = received;
+            int64_t offset = ((packet.t2 - packet.t1) + (packet.t3 - t4)) / 2;
+            int64_t delay = max((int64_t)0, (t4 - packet.t1) - (packet.t3 - packet.t2));
+            if (!answered || delay < best_delay) {
+                best_offset = offset;
+                best_delay = delay;
+            }
+            answered = true;
+            pending_t1 = 0;
+            break;
+        }
+    }
+}
+
+// true when the request pending got its reply
+bool PeerSync::receive(uint32_t wait_ms) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(group_fd, &fds);
+    FD_SET(fd, &fds);
+    timeval timeout = {(time_t)(wait_ms / 1000), (suseconds_t)(wait_ms % 1000 * 1000)};
+    if (select(max(fd, group_fd) + 1, &fds, nullptr, nullptr, &timeout) <= 0) return false;
+    if (FD_ISSET(fd, &fds)) handle(fd);
+    if (FD_ISSET(group_fd, &fds)) handle(group_fd);
+    return pending_t1 == 0;
+}
+
+// Requests to the leader one after the other, the packets of others are
+// handled while waiting. A request would tell a new leader it is one
+void PeerSync::measure() {
+    answered = false;
+    for (uint8_t i = 0; i < BURST; i++) {
+        Packet request = {};
+        request.type = REQUEST;
+        request.t1 = pending_t1 = nowUs();
+        send(request, leader.ip, leader.port);
+        uint32_t start = millis();
+        uint32_t spent;
+        while ((spent = millis() - start) < TIMEOUT_MS && !receive(TIMEOUT_MS - spent)) {}
+    }
+    pending_t1 = 0;
+    if (!answered || !clock->correct(best_offset, ClockDiscipline::SOURCE_PEER)) return;
+    {
+        std::lock_guard<std::mutex> guard(last_lock);
+        last.offset_us = best_offset;
+        last.delay_us = best_delay;
+    }
+    change_count++;
+}
+
+void PeerSync::service(uint32_t wait_ms) {
+    uint32_t now = millis();
+    if (now - last_beacon >= BEACON_MS) {
+        last_beacon = now;
+        Packet beacon = {};
+        beacon.type = BEACON;
+        send(beacon, inet_addr(PEER_GROUP), PEER_SYNC);
+    }
+    chooseLeader();
+    if (!leading() && now - last_poll >= POLL_MS) {
+        last_poll = now;
+        measure();
+    }
+    receive(wait_ms);
+}
+
+static void peerTask(void* arg) {
+    for (;;) ((PeerSync*)arg)->service(100);
+}
+
+bool PeerSync::start() {
+    // answers go out as soon as a request is in, above the push tasks
+    return xTaskCreatePinnedToCore(peerTask, "peer", 4096, this, 3, nullptr, otherCore()) == pdPASS;
+}
+
+PeerSync::Stats PeerSync::stats() const {
+    std::lock_guard<std::mutex> guard(last_lock);
+    return last;
+}
+
+void PeerSync::printStats() const {
+    Stats shown = stats();
+    if (shown.leader == id) {
+        Serial.printf("PEER leading %08x, %u peers\n", (unsigned)id, shown.peers);
+    } else {
+        Serial.printf("PEER following %08x, offset %+lld us, delay %u us, %u peers\n", (unsigned)shown.leader,
+                      (long long)shown.offset_us, (unsigned)shown.delay_us, shown.peers);
+    }
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "Pixel565.h"
+
+void fill565(uint16_t* dst, uint16_t color, uint32_t count) {
+    if (!count) return;
+    if ((uintptr_t)dst & 2) {   // get to a word boundary
+        *dst++ = color;
+        count--;
+    }
+
+    uint32_t two = ((uint32_t)color << 16) | color;
+    uint32_t* words = (uint32_t*)dst;
+    uint32_t n = count >> 1;
+    while (n >= 4) {
+        words[0] = two;
+        words[1] = two;
+        words[2] = two;
+        words[3] = two;
+        words += 4;
+        n -= 4;
+    }
+    while (n--) *words++ = two;
+
+    if (count & 1) *(uint16_t*)words = color;
+}
+
+void copy565(uint16_t* dst, const uint16_t* src, uint32_t count) {
+    // different alignment can't be fixed up by a leading pixel
+    if (((uintptr_t)dst ^ (uintptr_t)src) & 2) {
+        memcpy(dst, src, count * 2);
+        return;
+    }
+    if (!count) return;
+    if ((uintptr_t)dst & 2) {
+        *dst++ = *src++;
+        count--;
+    }
+
+    uint32_t* d = (uint32_t*)dst;
+    const uint32_t* s = (const uint32_t*)src;
+    uint32_t n = count >> 1;
+    while (n >= 4) {
+        d[0] = s[0];
+        d[1] = s[1];
+        d[2] = s[2];
+        d[3] = s[3];
+        d += 4;
+        s += 4;
+        n -= 4;
+    }
+    while (n--) *d++ = *s++;
+
+    if (count & 1) *(uint16_t*)d = *(const uint16_t*)s;
+}
@@ -0,0 +1,80 @@
+#include "PixelHeat.h"
+
+#ifdef PIXEL_HEATMAP
+
+static const char* const primitive_names = "fill,dial,text,line,circle,other";
+
+bool PixelHeat::begin(uint16_t width, uint16_t height) {
+    w = width;
+    h = height;
+    free(writes);
+    writes = nullptr;
+#ifdef BOARD_HAS_PSRAM
+    writes = (uint8_t*)ps_malloc(2 * w * h);
+#endif
+    if (!writes) writes = (uint8_t*)malloc(2 * w * h);
+    if (!writes) return false;
+    blends = writes + w * h;
+    reset();
+    return true;
+}
+
+void PixelHeat::reset() {
+    if (writes) memset(writes, 0, 2 * w * h);
+    memset(call_count, 0, sizeof(call_count));
+    memset(write_total, 0, sizeof(write_total));
+    memset(blend_total, 0, sizeof(blend_total));
+    current = OTHER;
+    depth = 0;
+}
+
+void PixelHeat::enter(Primitive p) {
+    if (depth++) return;
+    current = p;
+    call_count[p]++;
+}
+
+void PixelHeat::write(int32_t x, int32_t y, int32_t count) {
+    if (!writes || count <= 0) return;
+    uint32_t i = y * w + x;
+    uint32_t end = min(i + count, (uint32_t)w * h);
+    write_total[depth ? current : OTHER] += end - i;
+    for (; i < end; i++) bump(writes, i);
+}
+
+void PixelHeat::blend(int32_t x, int32_t y) {
+    if (!writes || x < 0 || y < 0 || x >= w || y >= h) return;
+    blend_total[depth ? current : OTHER]++;
+    bump(blends, y * w + x);
+}
+
+// Both planes run length coded as (u16 length, u8 count), then calls,
+// writes and blends per primitive as u32, all little endian
+void PixelHeat::dump(Print& out, const char* name) {
+    if (!writes) return;
+    uint32_t count = 2 * w * h;
+    for (int pass = 0; pass < 2; pass++) {
+        uint32_t bytes = 0;
+        for (uint32_t i = 0; i < count; bytes += 3) {
+            uint8_t v = writes[i];
+            uint32_t n = 1;
+            // runs stop at the end of the write plane
+            while (i + n < count && n < 0xFFFF && writes[i + n] == v && i + n != (uint32_t)w * h) n++;
+            if (pass) {
+                uint8_t run[3] = {(uint8_t)n, (uint8_t)(n >> 8), v};
+                out.write(run, 3);
+            }
+            i += n;
+        }
+        if (!pass) {
+            bytes += PRIMITIVES * 12;
+            out.printf("\nHEATMAP %s %u %u %u %s\n", name, w, h, (unsigned)bytes, primitive_names);
+        }
+    }
+    for (const uint32_t* table : {call_count, write_total, blend_total}) {
+        out.write((const uint8_t*)table, PRIMITIVES * 4);
+    }
+    out.flush();
+}
+
+#endif
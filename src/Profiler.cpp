@@ -0,0 +1,75 @@
+#include "Profiler.h"
+
+#if defined(PROFILER) || defined(TIMELINE)
+const char* const profile_names[EVENTS] = {
+    "frame", "time", "bus wait", "analog", "digital", "span", "push bus 0", "push bus 1", "serial", "ntp",
+    "select bus 0", "select bus 1", "ntp sync"
+};
+#endif
+
+#ifdef PROFILER
+#include <algorithm>
+#include <string.h>
+
+#ifdef ARDUINO
+#define PROFILE_PRINTF Serial.printf
+#else
+#include <stdio.h>
+#define PROFILE_PRINTF printf
+static uint32_t millis() { return Profiler::now() / 1000000; }
+#endif
+
+Profiler profiler;
+
+uint32_t Profiler::ticksPerUs() {
+#ifdef ARDUINO
+    static const uint32_t ticks = getCpuFrequencyMhz();
+#else
+    static const uint32_t ticks = 1000;
+#endif
+    return ticks;
+}
+
+void Profiler::record(uint8_t zone, uint32_t ticks) {
+    Zone& z = zones[zone];
+    z.samples[z.count % SAMPLES] = ticks;
+    uint32_t us = ticks / ticksPerUs();
+    uint8_t bucket = us ? std::min(32 - __builtin_clz(us), BUCKETS - 1) : 0;
+    z.buckets[bucket]++;
+    z.total += ticks;
+    if (ticks > z.max) z.max = ticks;
+    z.count++;
+}
+
+void Profiler::tick() {
+    uint32_t ms = millis();
+    if (ms - last_report < PROFILER * 1000UL) return;
+    last_report = ms;
+    PROFILE_ZONE(ZONE_SERIAL);
+    report();
+}
+
+// Counts and mean are since boot, percentiles over the last SAMPLES
+void Profiler::report() {
+    float tpu = ticksPerUs();
+    PROFILE_PRINTF("PROFILE %-10s %8s %9s %8s %8s %8s  histogram\n", "zone", "count", "mean us", "p50 us", "p90 us", "max us");
+    for (uint8_t i = 0; i < ZONES; i++) {
+        const Zone& z = zones[i];
+        uint32_t count = z.count;
+        if (!count) continue;
+        uint32_t sorted[SAMPLES];
+        uint8_t n = std::min<uint32_t>(count, SAMPLES);
+        memcpy(sorted, z.samples, n * sizeof(uint32_t));
+        std::sort(sorted, sorted + n);
+        PROFILE_PRINTF("PROFILE %-10s %8u %9.1f %8.1f %8.1f %8.1f ", profile_names[i], (unsigned)count,
+                       z.total / tpu / count, sorted[n / 2] / tpu, sorted[n * 9 / 10] / tpu, z.max / tpu);
+        for (uint8_t b = 0; b < BUCKETS; b++) {
+            if (!z.buckets[b]) continue;
+            if (b == BUCKETS - 1) PROFILE_PRINTF(" >=%uus:%u", 1u << (b - 1), (unsigned)z.buckets[b]);
+            else PROFILE_PRINTF(" <%uus:%u", 1u << b, (unsigned)z.buckets[b]);
+        }
+        PROFILE_PRINTF("\n");
+    }
+}
+
+#endif
@@ -0,0 +1,48 @@
+#include "SecondTicker.h"
+#include <sys/time.h>
+
+bool SecondTicker::begin() {
+    ready = xSemaphoreCreateBinary();
+    if (!ready) return false;
+    esp_timer_create_args_t args = {};
+    args.callback = fire;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "second";
+    if (esp_timer_create(&args, &timer) != ESP_OK) {
+        timer = nullptr;
+        return false;
+    }
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    esp_timer_start_once(timer, 1000000 - tv.tv_usec);
+    return true;
+}
+
+void SecondTicker::fire(void* arg) {
+    SecondTicker* ticker = (SecondTicker*)arg;
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    if (tv.tv_usec >= 500000) {
+        // the system clock is slewed against the timer, this went off
+        // just before the boundary, go again for the rest
+        esp_timer_start_once(ticker->timer, 1000000 - tv.tv_usec);
+        return;
+    }
+    ticker->second = tv.tv_sec;
+    if ((uint32_t)tv.tv_usec > ticker->max_late) ticker->max_late = tv.tv_usec;
+    xSemaphoreGive(ticker->ready);
+    esp_timer_start_once(ticker->timer, 1000000 - tv.tv_usec);
+}
+
+bool SecondTicker::wait(time_t* second, TickType_t timeout) {
+    if (!ready || xSemaphoreTake(ready, timeout) != pdTRUE) return false;
+    *second = this->second;
+    return true;
+}
+
+uint32_t SecondTicker::maxLate() {
+    uint32_t late = max_late;
+    max_late = 0;
+    return late;
+}
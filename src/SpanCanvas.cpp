@@ -0,0 +1,22 @@
+#include "SpanCanvas.h"
+
+void SpanCanvas::begin(const DisplayManager& displays, uint8_t face, int16_t w, int16_t h) {
+    panel_w = w;
+    panel_h = h;
+    bool first = true;
+    for (uint8_t i = 0; i < displays.panelCount(); i++) {
+        const Panel& p = displays.panel(i);
+        if (p.face != face) continue;
+        if (first || p.canvas_x < x0) x0 = p.canvas_x;
+        if (first || p.canvas_y < y0) y0 = p.canvas_y;
+        if (first || p.canvas_x + w > x1) x1 = p.canvas_x + w;
+        if (first || p.canvas_y + h > y1) y1 = p.canvas_y + h;
+        first = false;
+    }
+}
+
+bool SpanCanvas::visible(const Panel& panel, float left, float top, float right, float bottom) const {
+    float sx = sliceX(panel);
+    float sy = sliceY(panel);
+    return right >= sx && left < sx + panel_w && bottom >= sy && top < sy + panel_h;
+}
@@ -0,0 +1,146 @@
+#include "SpiTrace.h"
+
+#ifdef SPI_TRACE
+
+#ifndef SPI_TRACE_BYTES
+#ifdef BOARD_HAS_PSRAM
+#define SPI_TRACE_BYTES (2 * 1024 * 1024)
+#else
+#define SPI_TRACE_BYTES (48 * 1024)
+#endif
+#endif
+
+SpiTrace spi_trace;
+
+bool SpiTrace::begin(uint16_t frames, uint16_t width, uint16_t height) {
+    mutex = xSemaphoreCreateMutex();
+    if (!mutex) return false;
+#ifdef BOARD_HAS_PSRAM
+    buf = (uint8_t*)ps_malloc(SPI_TRACE_BYTES);
+#endif
+    if (!buf) buf = (uint8_t*)malloc(SPI_TRACE_BYTES);
+    if (!buf) return false;
+    size = SPI_TRACE_BYTES;
+    pos = 0;
+    put8('S'); put8('P'); put8('T'); put8('R');
+    put8(VERSION);
+    put16(width);
+    put16(height);
+    put16(frames);
+    this->frames = frames;
+    frames_done = 0;
+    state = RECORDING;
+    return true;
+}
+
+// Records are only written while recording, the buses call in from their
+// own tasks so each one is written under the mutex
+bool SpiTrace::lock() {
+    if (state != RECORDING) return false;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (state == RECORDING) return true;
+    unlock();
+    return false;
+}
+
+// Out of room: stop recording, the trace so far is still dumped
+bool SpiTrace::room(uint32_t bytes) {
+    if (pos + bytes <= size - 2) return true;
+    state = FULL;
+    return false;
+}
+
+void SpiTrace::frame() {
+    if (state == RECORDING && frames_done < frames) {
+        if (!lock()) return;
+        if (room(5)) {
+            put8('F');
+            put32(micros());
+            frames_done++;
+        }
+        unlock();
+        return;
+    }
+    if (state == RECORDING || state == FULL) {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        put8('E');
+        put8(state == FULL);
+        state = DONE;
+        xSemaphoreGive(mutex);
+        dump();
+    }
+}
+
+void SpiTrace::select(uint8_t bus, uint32_t mask) {
+    if (!lock()) return;
+    if (room(6)) {
+        put8('S');
+        put8(bus);
+        put32(mask);
+    }
+    unlock();
+}
+
+void SpiTrace::window(uint8_t bus, int32_t x, int32_t y, int32_t w, int32_t h) {
+    if (!lock()) return;
+    if (room(10)) {
+        put8('W');
+        put8(bus);
+        put16(x);
+        put16(y);
+        put16(w);
+        put16(h);
+    }
+    unlock();
+}
+
+void SpiTrace::command(uint8_t bus, uint8_t cmd, const uint8_t* data, uint8_t len) {
+    if (!lock()) return;
+    if (room(4 + len)) {
+        put8('C');
+        put8(bus);
+        put8(cmd);
+        put8(len);
+        for (uint8_t i = 0; i < len; i++) put8(data[i]);
+    }
+    unlock();
+}
+
+// Runs of equal pixels, the faces are mostly flat colour so this stays
+// small. A record that doesn't fit is dropped whole.
+void SpiTrace::pixels(uint8_t bus, const uint16_t* pixels, uint32_t count) {
+    if (!count || !lock()) return;
+    uint32_t start = pos;
+    if (room(6)) {
+        put8('P');
+        put8(bus);
+        put32(count);
+        uint32_t i = 0;
+        while (i < count) {
+            uint16_t color = pixels[i];
+            uint32_t run = 1;
+            while (i + run < count && run < 0xFFFF && pixels[i + run] == color) run++;
+            if (!room(4)) {
+                pos = start;
+                break;
+            }
+            put16(run);
+            put16(color);
+            i += run;
+        }
+    }
+    unlock();
+}
+
+// Framed by text lines so it can be picked out of the rest of the Serial
+// output
+void SpiTrace::dump() {
+    Serial.printf("\nSPI_TRACE %u\n", (unsigned)pos);
+    Serial.write(buf, pos);
+    Serial.println("\nSPI_TRACE_END");
+    Serial.flush();
+    free(buf);
+    buf = nullptr;
+}
+
+#endif
@@ -0,0 +1,188 @@
+#include "TimeZone.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Days since 1970-01-01 of a date, and back (proleptic Gregorian)
+static int32_t daysFromCivil(int32_t y, uint32_t m, uint32_t d) {
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = y - era * 400;
+    uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+static int32_t yearOf(int32_t days) {
+    days += 719468;
+    int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+    uint32_t doe = days - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    return (int32_t)yoe + era * 400 + (mp >= 10);
+}
+
+static bool isLeap(int32_t y) {
+    return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+}
+
+static int32_t floorDiv(int64_t a, int32_t b) {
+    return (int32_t)(a >= 0 ? a / b : -((-a + b - 1) / b));
+}
+
+// "CET" or "<+0330>"
+bool TimeZone::parseName(const char*& p) {
+    if (*p == '<') {
+        const char* close = strchr(p, '>');
+        if (!close) return false;
+        p = close + 1;
+        return true;
+    }
+    const char* begin = p;
+    while (isalpha((unsigned char)*p)) p++;
+    return p - begin >= 3;
+}
+
+// [+-]hh[:mm[:ss]]
+bool TimeZone::parseTime(const char*& p, int32_t* secs) {
+    int sign = 1;
+    if (*p == '+' || *p == '-') sign = *p++ == '-' ? -1 : 1;
+    if (!isdigit((unsigned char)*p)) return false;
+    int32_t parts[3] = {0, 0, 0};
+    for (int i = 0; i < 3; i++) {
+        while (isdigit((unsigned char)*p)) parts[i] = parts[i] * 10 + (*p++ - '0');
+        if (i == 2 || *p != ':') break;
+        p++;
+    }
+    *secs = sign * (parts[0] * 3600 + parts[1] * 60 + parts[2]);
+    return true;
+}
+
+bool TimeZone::parseRule(const char*& p, Rule* rule) {
+    rule->time = 2 * 3600;
+    if (*p == 'M') {
+        p++;
+        rule->kind = 'M';
+        int v[3];
+        for (int i = 0; i < 3; i++) {
+            if (i && *p++ != '.') return false;
+            if (!isdigit((unsigned char)*p)) return false;
+            v[i] = strtol(p, (char**)&p, 10);
+        }
+        if (v[0] < 1 || v[0] > 12 || v[1] < 1 || v[1] > 5 || v[2] > 6) return false;
+        rule->month = v[0];
+        rule->week = v[1];
+        rule->weekday = v[2];
+    } else {
+        rule->kind = 'D';
+        if (*p == 'J') {
+            p++;
+            rule->kind = 'J';
+        }
+        if (!isdigit((unsigned char)*p)) return false;
+        rule->day = strtol(p, (char**)&p, 10);
+        if (rule->day > 365 || (rule->kind == 'J' && rule->day < 1)) return false;
+    }
+    if (*p == '/') {
+        p++;
+        return parseTime(p, &rule->time);
+    }
+    return true;
+}
+
+// Leaves the zone as it was if the string doesn't parse
+bool TimeZone::parse(const char* posix) {
+    TimeZone zone;
+    if (!zone.read(posix)) return false;
+    *this = zone;
+    return true;
+}
+
+bool TimeZone::read(const char* posix) {
+    const char* p = posix;
+    int32_t west;
+    if (!parseName(p) || !parseTime(p, &west)) return false;
+    std_offset = -west;     // POSIX offsets count west of Greenwich
+    if (!*p) return true;
+
+    if (!parseName(p)) return false;
+    has_dst = true;
+    dst_offset = std_offset + 3600;
+    if (*p && *p != ',') {
+        if (!parseTime(p, &west)) return false;
+        dst_offset = -west;
+    }
+    if (!*p) {
+        // no rules, newlib falls back to the US ones
+        start = {'M', 3, 2, 0, 0, 2 * 3600};
+        end = {'M', 11, 1, 0, 0, 2 * 3600};
+        return true;
+    }
+    if (*p++ != ',' || !parseRule(p, &start)) return false;
+    if (*p++ != ',' || !parseRule(p, &end)) return false;
+    return *p == 0;
+}
+
+// When the rule fires in the year, in UTC. The rule's time is local time
+// before the change.
+time_t TimeZone::transition(int year, const Rule& rule, int32_t offset_before) const {
+    int32_t days;
+    if (rule.kind == 'M') {
+        int32_t first = daysFromCivil(year, rule.month, 1);
+        int32_t weekday = ((first % 7) + 11) % 7;      // 1970-01-01 was a Thursday
+        int32_t mday = 1 + (rule.weekday - weekday + 7) % 7 + (rule.week - 1) * 7;
+        static const uint8_t month_days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        int32_t length = month_days[rule.month - 1] + (rule.month == 2 && isLeap(year));
+        while (mday > length) mday -= 7;
+        days = first + mday - 1;
+    } else if (rule.kind == 'J') {
+        // Feb 29th is never counted
+        days = daysFromCivil(year, 1, 1) + rule.day - 1 + (rule.day >= 60 && isLeap(year));
+    } else {
+        days = daysFromCivil(year, 1, 1) + rule.day;
+    }
+    return (time_t)days * 86400 + rule.time - offset_before;
+}
+
+// Finds the changes on either side of utc, among those of the year
+// before, that year and the next
+void TimeZone::update(time_t utc) {
+    if (!has_dst) {
+        current = std_offset;
+        current_dst = false;
+        valid_from = INT32_MIN;
+        valid_until = INT32_MAX;
+        return;
+    }
+    int32_t year = yearOf(floorDiv(utc + std_offset, 86400));
+    time_t from = INT32_MIN, until = INT32_MAX;
+    bool dst = false;
+    for (int32_t y = year - 1; y <= year + 1; y++) {
+        time_t changes[2] = {transition(y, start, std_offset), transition(y, end, dst_offset)};
+        for (int i = 0; i < 2; i++) {
+            if (changes[i] <= utc && changes[i] >= from) {
+                from = changes[i];
+                dst = i == 0;
+            } else if (changes[i] > utc && changes[i] < until) {
+                until = changes[i];
+            }
+        }
+    }
+    current = dst ? dst_offset : std_offset;
+    current_dst = dst;
+    valid_from = from;
+    valid_until = until;
+}
+
+int32_t TimeZone::offset(time_t utc, bool* dst) {
+    if (utc < valid_from || utc >= valid_until) update(utc);
+    if (dst) *dst = current_dst;
+    return current;
+}
+
+int32_t TimeZone::daySeconds(time_t utc, bool* dst) {
+    int64_t local = (int64_t)utc + offset(utc, dst);
+    int32_t secs = local % 86400;
+    return secs < 0 ? secs + 86400 : secs;
+}
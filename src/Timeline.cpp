@@ -0,0 +1,81 @@
+#include "Timeline.h"
+#include "Profiler.h"
+
+#ifdef TIMELINE
+
+Timeline timeline;
+
+// a free slot holds the position it will be written at
+Timeline::Timeline() {
+    for (uint32_t i = 0; i < SIZE; i++) ring[i].seq.store(i, std::memory_order_relaxed);
+}
+
+void Timeline::begin(const char* const* names, uint8_t count) {
+    this->names = names;
+    name_count = count;
+    sendNames();
+}
+
+void Timeline::record(uint8_t id, Phase phase, uint32_t arg) {
+    uint32_t us = micros();
+    uint32_t pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = ring[pos & MASK];
+        int32_t diff = (int32_t)(slot.seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            // claim it, another task may get there first
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.event = {us, arg, id, (uint8_t)(phase | xPortGetCoreID() << 7), 0};
+                slot.seq.store(pos + 1, std::memory_order_release);
+                return;
+            }
+        } else if (diff < 0) {
+            // the loop hasn't sent this slot yet, the ring is full
+            dropped++;
+            return;
+        } else {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Timeline::sendNames() {
+    if (!names) return;
+    String line = "\nTIMELINE_NAMES ";
+    for (uint8_t i = 0; i < name_count; i++) {
+        if (i) line += ',';
+        line += names[i];
+    }
+    line += '\n';
+    Serial.write((const uint8_t*)line.c_str(), line.length());
+    names_sent = millis();
+}
+
+// Sends the events that are complete and fit in the UART buffer, the rest
+// waits for the next frame
+void Timeline::drain() {
+    PROFILE_ZONE(ZONE_SERIAL);
+    if (millis() - names_sent > 5000) sendNames();
+
+    static const int HEADER = 32;
+    int room = Serial.availableForWrite() - HEADER;
+    uint32_t n = 0;
+    while (n < CHUNK && (int)(n + 1) * (int)sizeof(Event) <= room &&
+           ring[(tail + n) & MASK].seq.load(std::memory_order_acquire) == tail + n + 1) {
+        n++;
+    }
+    uint32_t lost = dropped.exchange(0);
+    if (!n && !lost) return;
+
+    uint8_t out[HEADER + CHUNK * sizeof(Event)];
+    size_t len = snprintf((char*)out, HEADER, "\nTIMELINE %u %u\n", (unsigned)n, (unsigned)lost);
+    for (uint32_t i = 0; i < n; i++, tail++) {
+        Slot& slot = ring[tail & MASK];
+        memcpy(out + len, &slot.event, sizeof(Event));
+        len += sizeof(Event);
+        slot.seq.store(tail + SIZE, std::memory_order_release);
+    }
+    Serial.write(out, len);
+}
+
+#endif
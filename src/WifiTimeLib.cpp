@@ -1,7 +1,8 @@
 #include "WifiTimeLib.h"
+#include "Profiler.h"
 // inspired by https://github.com/SensorsIot/NTP-time-for-ESP8266-and-ESP32/blob/master/NTP_Example/NTP_Example.ino
 
-WifiTimeLib::WifiTimeLib(const char* ntp_server, const char* tz_info) : NTP_SERVER(ntp_server), TZ_INFO(tz_info) {}
+WifiTimeLib::WifiTimeLib(NtpClient* ntp, const char* tz_info) : ntp(ntp), TZ_INFO(tz_info) {}
 
 String WifiTimeLib::getFormattedDate(){
     char time_output[30];
@@ -49,34 +50,37 @@ void WifiTimeLib::configModeCallback(WiFiManager *wm) {
 // retrieve NTP time with an optional timeout in seconds
 bool WifiTimeLib::getNTPtime(int timeout=10) {
     if (WiFi.isConnected()) {
+        PROFILE_ZONE(ZONE_NTP);
         bool timeout_reached = false;
+        bool synced = false;
         long start = millis();
 
         Serial.println(" updating:");
-        configTime(0, 0, NTP_SERVER);
         setenv("TZ", TZ_INFO, 1);
+        tzset();
 
         do {
-            timeout_reached = (millis() - start) > (1000 * timeout);
-            time(&now);
-            localtime_r(&now, &timeinfo);
-            if (timeinfo.tm_year > (2023 - 1900)) break;
+            synced = ntp->sync();
+            if (synced) break;
             Serial.print(" . ");
-            delay(100);
+            delay(500);
+            timeout_reached = (millis() - start) > (1000 * timeout);
         } while (!timeout_reached);
+        time(&now);
+        localtime_r(&now, &timeinfo);
 
         // print what we got
         Serial.println();
         Serial.println(getFormattedDate());
         Serial.println(getFormattedTime());
 
-        if (timeinfo.tm_year < (2023 - 1900)){
+        if (!synced) {
+            Serial.println("Error: Timeout while trying to update the current time with NTP");
+            return false;
+        } else if (timeinfo.tm_year < (2023 - 1900)){
             Serial.println("Error: Invalid date received!");
             Serial.println(timeinfo.tm_year);
             return false;  // the NTP call was not successful
-        } else if (timeout_reached) {
-            Serial.println("Error: Timeout while trying to update the current time with NTP");
-            return false;
         } else {
             Serial.println("[ok] time updated: ");
             return true;
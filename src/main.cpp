@@ -4,6 +4,24 @@
 #include <SPI.h>
 #include <TFT_eSPI.h>     // https://github.com/Bodmer/TFT_eSPI
 #include "WifiTimeLib.h"
+#include "NtpClient.h"
+#include "ClockDiscipline.h"
+#include "PeerSync.h"
+#include "ClockMemory.h"
+#include "ClockSprite.h"
+#include "Benchmarks.h"
+#include "DisplayManager.h"
+#include "SpanCanvas.h"
+#include "PanelBus.h"
+#include "Cores.h"
+#include "SpiTrace.h"
+#include "Profiler.h"
+#include "Pixel565.h"
+#include "ClockSource.h"
+#include "TimeZone.h"
+#include "SecondTicker.h"
+#include "Faces.h"
+#include "GoldenFrames.h"
 
 // Timezone config
 /* 
@@ -13,177 +31,384 @@
   For example: USA eastern time: "EST5EDT,M3.2.0,M11.1.0", Central EU time: "CET-1CEST,M3.5.0,M10.5.0/3"
   Pool can be "pool.ntp.org" or something more local
 */
-// Set up WiFI and time sync, replace these with your own time settings (NTP server and timezone)
-WifiTimeLib wifiTimeLib("ch.pool.ntp.org", "CET-1CEST-2,M3.5.0/02:00:00,M10.5.0/03:00:00"); // Switzerland
+// Set up WiFI and time sync, replace these with your own time settings (NTP servers and timezone)
+const char* tz_info = "CET-1CEST-2,M3.5.0/02:00:00,M10.5.0/03:00:00"; // Switzerland
+#ifndef NTP_SERVERS
+#define NTP_SERVERS "0.ch.pool.ntp.org", "1.ch.pool.ntp.org", "2.ch.pool.ntp.org"
+#endif
+#ifndef NTP_POLL
+#define NTP_POLL 256    // seconds between syncs, the drift estimate covers the time in between
+#endif
+const char* const ntp_servers[] = {NTP_SERVERS};
+ClockDiscipline clock_discipline;
+ClockMemory clock_memory;
+NtpClient ntp_client(ntp_servers, sizeof(ntp_servers) / sizeof(ntp_servers[0]), &clock_discipline);
+WifiTimeLib wifiTimeLib(&ntp_client, tz_info);
+uint32_t ntp_reported = 0;   // syncs printed so far
+#ifdef PEER_SYNC
+PeerSync peer_sync(&clock_discipline);
+uint32_t peer_reported = 0;
+#endif
 
 // Font files are stored in SPIFFS (flash ram)
 #define FS_NO_GLOBALS
 #include <FS.h>
 
 TFT_eSPI tft = TFT_eSPI();  // Invoke library, pins defined in User_Setup.h
-TFT_eSprite digital_face_hours = TFT_eSprite(&tft);
-TFT_eSprite digital_face_minutes = TFT_eSprite(&tft);
-TFT_eSprite analog_face = TFT_eSprite(&tft);
-
-#define CLOCK_X_POS 118
-#define CLOCK_Y_POS 118
-
-#define CLOCK_FG   TFT_LIGHTGREY
-#define CLOCK_BG   TFT_BROWN
-#define SECCOND_FG TFT_YELLOW
-#define LABEL_FG   TFT_RED
-
-#define CLOCK_R       240.0f / 2.0f // Clock face radius (float type)
-#define H_HAND_LENGTH CLOCK_R/2.2f
-#define M_HAND_LENGTH CLOCK_R/1.5f
-#define S_HAND_LENGTH CLOCK_R/1.2f
-
-// Calculate 1 second increment angles. Hours and minute hand angles
-// change every second so we see smooth sub-pixel movement
-#define SECOND_ANGLE 360.0 / 60.0
-#define MINUTE_ANGLE SECOND_ANGLE / 60.0
-#define HOUR_ANGLE   MINUTE_ANGLE / 12.0
-
-// Screen width and height
-#define SCREEN_W 240
-#define SCREEN_H 240
+ClockSprite digital_face_hours = ClockSprite(&tft);
+ClockSprite digital_face_minutes = ClockSprite(&tft);
+ClockSprite analog_face = ClockSprite(&tft);
+
+// Panels can be split over both SPI hosts: bus 0 is TFT_eSPI's, bus 1 is
+// the second host with the PANEL_BUS2_* pins from platformio.ini. Each bus
+// has a push task and its own face sprite, so one bus sends a frame while
+// the other one's is drawn.
+TftPanelBus main_bus;
+#ifdef PANEL_BUS2_MOSI
+#ifndef PANEL_BUS2_RST
+#define PANEL_BUS2_RST -1
+#endif
+#ifndef PANEL_BUS2_FREQUENCY
+#define PANEL_BUS2_FREQUENCY 40000000
+#endif
+SpiPanelBus second_bus;
+ClockSprite analog_face_bus2 = ClockSprite(&tft);
+PanelBus* buses[] = {&main_bus, &second_bus};
+#else
+PanelBus* buses[] = {&main_bus};
+#endif
+#define num_buses (sizeof(buses) / sizeof(buses[0]))
+
+// the sprite the analog and span faces draw into for a bus
+ClockSprite& faceSprite(uint8_t bus) {
+#ifdef PANEL_BUS2_MOSI
+  if (bus == 1) return analog_face_bus2;
+#endif
+  return analog_face;
+}
 
 // handle multiple displays via CS pin
-#define num_displays 2
-uint8_t display_cs_pins[num_displays] = {22,21};
-uint16_t bg_colors[num_displays] = {TFT_DARKGREEN, TFT_BLUE};
+// Mirrored panels showing the same face on the same background are rendered
+// once and pushed once, with all their CS lines low together
+// SPAN_FACE panels each show their slice of one canvas, at canvas x,y
+// A panel with a timezone shows the time there, the others use tz_info
+enum { ANALOG_FACE, DIGITAL_FACE, SPAN_FACE };
+Panel panels[] = {
+  // CS pin, face, background, mirrored, canvas x, canvas y, bus, timezone
+  {22, ANALOG_FACE,  TFT_DARKGREEN, false, 0, 0, 0},
+  {21, DIGITAL_FACE, TFT_BLUE,      false, 0, 0, 0},
+  // two panels side by side sharing one sweeping hand and ticker:
+  // {17, SPAN_FACE,    TFT_BLACK,     false, 0,   0, 0},
+  // {16, SPAN_FACE,    TFT_BLACK,     false, 240, 0, 0},
+  // a panel on the second SPI host, needs the PANEL_BUS2_* build flags:
+  // {15, ANALOG_FACE,  TFT_DARKGREEN, false, 0, 0, 1},
+  // a world clock, more panels in other cities:
+  // {17, ANALOG_FACE,  TFT_NAVY,      false, 0, 0, 0, "EST5EDT,M3.2.0,M11.1.0"},       // New York
+  // {16, ANALOG_FACE,  TFT_MAROON,    false, 0, 0, 0, "JST-9"},                        // Tokyo
+};
+#define num_displays (sizeof(panels) / sizeof(panels[0]))
+DisplayManager displays(panels, num_displays);
+SpanCanvas span_canvas;
+
+#define TICKER_SPEED 60     // canvas pixels per second
+
+// blends of the face colours over each background, see setupDisplays()
+BlendLut blend_lut;
 
 // Time 
-tm timeinfo;
-time_t now;
+SystemClock system_clock;
+ClockSource* clock_source = &system_clock;   // where loop() reads the time
+TimeZone local_zone;                         // tz_info, parsed once
+TimeZone panel_zones[num_displays];          // each panel's own, or a copy of local_zone
 int hour = 0;
 int minute = 0;
 int second = 0;
 
 
 // =========================================================================
-// Get coordinates of end of a line, pivot at x,y, length r, angle a
+// Draw the clock face in the sprite
 // =========================================================================
-// Coordinates are returned to caller via the xp and yp pointers
-#define DEG2RAD 0.0174532925
-void getCoord(int16_t x, int16_t y, float *xp, float *yp, int16_t r, float a)
-{
-  float sx1 = cos( (a - 90) * DEG2RAD);
-  float sy1 = sin( (a - 90) * DEG2RAD);
-  *xp =  sx1 * r + x;
-  *yp =  sy1 * r + y;
+int hours_shown[num_displays];   // hour on each digital panel, -1 for none
+
+std::atomic<int> digital_pending{0};   // digit sprite pushes not sent yet
+
+// the hours sprite is shared by all the digital panels, only redraw it
+// when they don't show the same hour on the same background
+static int sprite_hr = -1;
+static uint16_t sprite_bg = 0;
+
+static void updateDigitalHours(int hr, uint16_t bg_color) {
+  if (sprite_hr == hr && sprite_bg == bg_color) return;
+  sprite_hr = hr;
+  sprite_bg = bg_color;
+  drawDigitalHours(digital_face_hours, hr, bg_color);
 }
 
-// =========================================================================
-// Draw the clock face in the sprite
-// =========================================================================
-static void renderDigitalFace(float t, uint16_t bg_color) {
-  static int last_hr = 1000;
-  char cnum[10];
+static void renderDigitalFace(day_us_t t, const PanelGroup& group) {
+  uint16_t bg_color = displays.panel(group.first).bg_color;
+  int hr = t / US_PER_HOUR;
+
+  // the digit sprites are shared by all digital panels, let their last
+  // pushes finish. Only those, the analog frames on the bus don't matter
+  while (digital_pending.load()) vTaskDelay(1);
+  PROFILE_ZONE(ZONE_DIGITAL);
 
   // update hours
-  if (last_hr != (int)t/3600){
-    last_hr = (int)t/3600;
-    digital_face_hours.fillSprite(bg_color);
-    digital_face_hours.setTextColor(CLOCK_FG, bg_color);  
-    digital_face_hours.setTextDatum(MR_DATUM);
-    snprintf(cnum, 10, "%02d", (int)t/3600);  // hours
-    digital_face_hours.drawString(cnum, digital_face_hours.width()-2, digital_face_hours.height()/2);    
-    digital_face_hours.pushSprite(2, tft.height()/2 - digital_face_hours.height()/2); 
+  if (hours_shown[group.first] != hr){
+    hours_shown[group.first] = hr;
+    updateDigitalHours(hr, bg_color);
+    buses[group.bus]->submit(&digital_face_hours, HOURS_X, DIGITS_Y, group, &digital_pending, true);
   }
   
   // update minutes and seconds
-  digital_face_minutes.fillSprite(bg_color);
-  digital_face_minutes.setTextColor(TFT_ORANGE, bg_color);  
-  digital_face_minutes.setTextDatum(ML_DATUM);
-  // minutes
-  snprintf(cnum, 10, "%02d", (int)t/60 % 60);
-  digital_face_minutes.drawString(cnum, 0, digital_face_minutes.height()*0.3);
-  digital_face_minutes.setTextColor(TFT_SKYBLUE, bg_color);  
-  // seconds
-  snprintf(cnum, 10, "%02d", (int)floor(t) % 60);
-  digital_face_minutes.drawString(cnum, 0, digital_face_minutes.height()*0.7);
-
-  digital_face_minutes.pushSprite(tft.width()/1.8, tft.height()/2 - digital_face_minutes.height()/2); 
+  drawDigitalMinutes(digital_face_minutes, t, bg_color);
+  buses[group.bus]->submit(&digital_face_minutes, MINUTES_X, DIGITS_Y, group, &digital_pending, true);
 }
 
 // =========================================================================
-// Draw the clock face in the sprite
+// Digital panels on the second tick
 // =========================================================================
-static void renderAnalogFace(float t, uint16_t bg_color) {
-  float h_angle = t * HOUR_ANGLE;
-  float m_angle = t * MINUTE_ANGLE;
-  float s_angle = t * SECOND_ANGLE;
-  
-  // The face is completely redrawn - this can be done quickly
-  analog_face.fillSprite(bg_color);
+// On the system clock the digital panels don't wait for the loop to notice
+// a new second. A task woken by the second ticker pushes them right at the
+// boundary, and their pushes go ahead of the analog frames waiting on the
+// bus.
+//
+// The next second is known, so it is drawn during the second before: each
+// digital group has its own pair of plain sprites the digits are copied
+// into from the font sprites. At the tick only the pushes are left, all
+// the digital panels flip within their transfer times. Without the RAM for
+// them the digits are drawn at the tick, one group after the other.
+SecondTicker second_ticker;
+bool digital_on_tick = false;   // the loop leaves the digital panels alone
+// the task's own copies of panel_zones, looking a time up rewrites the
+// cached offset and the loop may be in the middle of the same at a DST change
+TimeZone digital_zones[num_displays];
+
+struct DigitalAhead {
+  DigitalAhead() : hours(&tft), minutes(&tft) {}
+  ClockSprite hours;
+  ClockSprite minutes;
+  int hour;        // hour in the hours sprite
+  bool new_hour;   // it has to be pushed
+};
+DigitalAhead* digital_ahead[num_displays];   // by first panel of the group
+bool render_ahead = false;
+time_t ahead_second = 0;   // the second the sprites are drawn for
+
+static bool isDigitalGroup(const PanelGroup& group) {
+  return group.bus < num_buses && displays.panel(group.first).face == DIGITAL_FACE;
+}
 
-  // Set text datum to middle centre and the colour
-  analog_face.setTextDatum(MC_DATUM);
+static void renderDigitalPanels(time_t utc) {
+  for (uint8_t g=0; g < displays.groupCount(); g++){
+    const PanelGroup& group = displays.group(g);
+    if (!isDigitalGroup(group)) continue;
+    renderDigitalFace(digital_zones[group.first].daySeconds(utc) * US_PER_SEC, group);
+  }
+}
 
-  // The background colour will be read during the character rendering
-  analog_face.setTextColor(CLOCK_FG, bg_color);
+static void copySprite(ClockSprite& dst, ClockSprite& src) {
+  copy565((uint16_t*)dst.getPointer(), (const uint16_t*)src.getPointer(), src.width() * src.height());
+}
 
-  // Text offset adjustment
-  constexpr uint32_t dialOffset = CLOCK_R - 15;
+// draw second utc of every digital group, once the pushes of the current
+// one are out of the sprites
+static void renderDigitalAhead(time_t utc) {
+  while (digital_pending.load()) vTaskDelay(1);
+  PROFILE_ZONE(ZONE_DIGITAL);
+  for (uint8_t g=0; g < displays.groupCount(); g++){
+    const PanelGroup& group = displays.group(g);
+    if (!isDigitalGroup(group)) continue;
+    DigitalAhead* ahead = digital_ahead[group.first];
+    uint16_t bg_color = displays.panel(group.first).bg_color;
+    day_us_t t = digital_zones[group.first].daySeconds(utc) * US_PER_SEC;
+
+    ahead->hour = t / US_PER_HOUR;
+    ahead->new_hour = hours_shown[group.first] != ahead->hour;
+    if (ahead->new_hour){
+      updateDigitalHours(ahead->hour, bg_color);
+      copySprite(ahead->hours, digital_face_hours);
+    }
+    drawDigitalMinutes(digital_face_minutes, t, bg_color);
+    copySprite(ahead->minutes, digital_face_minutes);
+  }
+  ahead_second = utc;
+}
 
-  float xp = 0.0, yp = 0.0; // Use float pixel position for smooth AA motion
+static void pushDigitalAhead() {
+  for (uint8_t g=0; g < displays.groupCount(); g++){
+    const PanelGroup& group = displays.group(g);
+    if (!isDigitalGroup(group)) continue;
+    DigitalAhead* ahead = digital_ahead[group.first];
+    if (ahead->new_hour){
+      hours_shown[group.first] = ahead->hour;
+      buses[group.bus]->submit(&ahead->hours, HOURS_X, DIGITS_Y, group, &digital_pending, true);
+    }
+    buses[group.bus]->submit(&ahead->minutes, MINUTES_X, DIGITS_Y, group, &digital_pending, true);
+  }
+}
 
-  // Draw digits around clock perimeter
-  for (uint32_t h = 1; h <= 12; h++) {
-    getCoord(CLOCK_R, CLOCK_R, &xp, &yp, dialOffset, h * 360.0 / 12);
-    analog_face.drawNumber(h, xp, 2 + yp);
+static void digitalTask(void*) {
+  time_t second;
+  for (;;) {
+    if (!second_ticker.wait(&second)) continue;
+    // after a clock step the sprites hold some other second
+    if (render_ahead && ahead_second == second) pushDigitalAhead();
+    else renderDigitalPanels(second);
+    if (render_ahead) renderDigitalAhead(second + 1);
   }
+}
 
-  // Add text (could be digital time...)
-  analog_face.setTextColor(LABEL_FG, bg_color);
-  //face.drawString("TFT_eSPI", CLOCK_R, CLOCK_R * 0.75);
+// a pair of sprites per digital group, or none at all
+static bool setupDigitalAhead() {
+  bool ok = true;
+  for (uint8_t g=0; g < displays.groupCount() && ok; g++){
+    const PanelGroup& group = displays.group(g);
+    if (!isDigitalGroup(group)) continue;
+    DigitalAhead* ahead = new DigitalAhead();
+    digital_ahead[group.first] = ahead;
+    ok = ahead->hours.createSprite(digital_face_hours.width(), digital_face_hours.height()) &&
+         ahead->minutes.createSprite(digital_face_minutes.width(), digital_face_minutes.height());
+  }
+  if (ok) return true;
+  for (DigitalAhead*& ahead : digital_ahead){
+    if (!ahead) continue;
+    ahead->hours.deleteSprite();
+    ahead->minutes.deleteSprite();
+    delete ahead;
+    ahead = nullptr;
+  }
+  return false;
+}
 
-  // Draw minute hand
-  getCoord(CLOCK_R, CLOCK_R, &xp, &yp, M_HAND_LENGTH, m_angle);
-  analog_face.drawWideLine(CLOCK_R, CLOCK_R, xp, yp, 8.0f, CLOCK_FG);
-  analog_face.drawWideLine(CLOCK_R, CLOCK_R, xp, yp, 4.0f, TFT_GREEN);
+static void startDigitalTask() {
+  // a warped clock has its own seconds
+  if (clock_source != &system_clock) return;
+  bool any = false;
+  for (uint8_t i=0; i < num_displays; i++) any |= panels[i].face == DIGITAL_FACE;
+  if (!any) return;
+  for (uint8_t i=0; i < num_displays; i++) digital_zones[i] = panel_zones[i];
+  render_ahead = setupDigitalAhead();
+  if (!render_ahead) Serial.println("WARNING: no RAM to draw the digital panels ahead");
+  // same core as the loop, it gets the CPU as soon as it wakes
+  if (!second_ticker.begin() ||
+      xTaskCreatePinnedToCore(digitalTask, "digital", 6144, nullptr, 3, nullptr, xPortGetCoreID()) != pdPASS){
+    Serial.println("ERROR: no second ticker, the loop draws the digital panels");
+    return;
+  }
+  digital_on_tick = true;
+}
 
-  // Draw hour hand
-  getCoord(CLOCK_R, CLOCK_R, &xp, &yp, H_HAND_LENGTH, h_angle);
-  analog_face.drawWideLine(CLOCK_R, CLOCK_R, xp, yp, 8.0f, CLOCK_FG);
-  analog_face.drawWideLine(CLOCK_R, CLOCK_R, xp, yp, 4.0f, TFT_GREENYELLOW);
+// =========================================================================
+// Hands drawn for the time they reach the glass
+// =========================================================================
+// A frame shows up on its panels a render, a wait in the bus queue and a
+// push after the loop read the clock. Each group keeps a moving average of
+// that and its hands are drawn that far ahead, so the second hand is on
+// the mark when the digital panels flip. Only on the system clock, warped
+// time doesn't run at the speed of the pushes.
+PushLatency frame_latency[num_displays];   // by first panel of the group
+uint32_t frame_read_us = 0;                // when this frame read the clock
+
+static day_us_t onGlass(day_us_t t, const PanelGroup& group) {
+  if (clock_source != &system_clock) return t;
+  return (t + frame_latency[group.first].average()) % US_PER_DAY;
+}
 
-  // Draw the central pivot circle
-  analog_face.fillSmoothCircle(CLOCK_R, CLOCK_R, 8, CLOCK_FG);
+static void submitFrame(ClockSprite& face, const PanelGroup& group) {
+  frame_latency[group.first].begin(frame_read_us);
+  buses[group.bus]->submitFrame(&face, 0, 0, group, &frame_latency[group.first]);
+}
 
-  // Draw second hand
-  getCoord(CLOCK_R, CLOCK_R, &xp, &yp, S_HAND_LENGTH, s_angle);
-  analog_face.drawWedgeLine(CLOCK_R, CLOCK_R, xp, yp, 3.5, 1.5, SECCOND_FG);
-  analog_face.pushSprite(0, 0, TFT_TRANSPARENT);
+static void renderAnalogFace(day_us_t t, const PanelGroup& group) {
+  // wait until this bus has sent the last frame drawn in its sprite
+  ClockSprite& face = faceSprite(group.bus);
+  buses[group.bus]->wait();
+  PROFILE_ZONE(ZONE_ANALOG);
+  drawAnalogFace(face, onGlass(t, group), displays.panel(group.first).bg_color);
+  submitFrame(face, group);
 }
 
 
 // =========================================================================
-// Setup displays
+// Draw one panel's slice of the spanning canvas
 // =========================================================================
+// Positions are worked out on the canvas and shifted by the panel's offset.
+// The sprite clips, and shapes that miss this panel are skipped entirely.
+static void renderSpanFace(day_us_t t, const PanelGroup& group) {
+  const Panel& panel = displays.panel(group.first);
+  float ox = span_canvas.sliceX(panel);
+  float oy = span_canvas.sliceY(panel);
+  float cx = span_canvas.width() / 2.0f;    // pivot in the canvas centre
+  float cy = span_canvas.height() / 2.0f;
+  float xp = 0.0, yp = 0.0;
+  char ticker[10];
+
+  ClockSprite& face = faceSprite(group.bus);
+  buses[group.bus]->wait();
+  PROFILE_ZONE(ZONE_SPAN);
+  t = onGlass(t, group);
+
+  face.fillSprite(panel.bg_color);
+
+  // time ticker running right to left over the whole canvas
+  int secs = t / US_PER_SEC;
+  snprintf(ticker, 10, "%02d:%02d:%02d", secs/3600, secs/60 % 60, secs % 60);
+  int16_t tw = face.textWidth(ticker);
+  int64_t travel = t * TICKER_SPEED % ((span_canvas.width() + tw) * US_PER_SEC);
+  float tx = span_canvas.width() - travel * (1.0f / US_PER_SEC);
+  float ty = span_canvas.height() * 0.75f;
+  if (span_canvas.visible(panel, tx, ty - 20, tx + tw, ty + 20)){
+    face.setTextDatum(ML_DATUM);
+    face.setTextColor(LABEL_FG, panel.bg_color);
+    face.drawString(ticker, tx - ox, ty - oy);
+  }
 
-void setupDisplays(){
-  for (int i=0; i < num_displays; i++){
-    pinMode(display_cs_pins[i], OUTPUT);
-    digitalWrite(display_cs_pins[i],HIGH);
+  // second hand long enough to sweep across all the panels
+  getCoord(cx, cy, &xp, &yp, cx - 10, handTurn(t, SECOND_PERIOD));
+  if (span_canvas.visible(panel, min(cx, xp) - 6, min(cy, yp) - 6, max(cx, xp) + 6, max(cy, yp) + 6)){
+    face.drawWedgeLine(cx - ox, cy - oy, xp - ox, yp - oy, 6.0f, 2.0f, SECCOND_FG);
+  }
+  if (span_canvas.visible(panel, cx - 12, cy - 12, cx + 12, cy + 12)){
+    face.fillSmoothCircle(cx - ox, cy - oy, 12, CLOCK_FG);
   }
-  
-  // Create the clock face sprite
-  //face.setColorDepth(8); // 8 bit will work, but reduces effectiveness of anti-aliasing
-  digital_face_minutes.createSprite(SCREEN_W / 2, SCREEN_H / 2);
-  digital_face_minutes.loadFont("Mali-Bold-60");
 
-  digital_face_hours.createSprite(SCREEN_W / 2, SCREEN_H / 2);  
-  digital_face_hours.loadFont("Mali-Bold-90");
+  submitFrame(face, group);
+}
 
-  analog_face.createSprite(SCREEN_W, SCREEN_H);
-  analog_face.loadFont("Futura-MediumItalic-18"); // prepare for analog updates afterwards
+// =========================================================================
+// Setup displays
+// =========================================================================
 
-  // Initialize displays
-  for (int i=0; i < num_displays; i++){
-    digitalWrite(display_cs_pins[i],LOW);
-  }
+// Sprites made after initDMA() have to fit in normal RAM, when that has
+// run out they go in PSRAM instead (pushed by the CPU, if they are pushed)
+static bool createSprite(ClockSprite& sprite, int16_t w, int16_t h){
+  if (sprite.createSprite(w, h)) return true;
+  tft.deInitDMA();
+  sprite.createSprite(w, h);
+  tft.initDMA();
+  if (sprite.created()) return true;
+  Serial.printf("ERROR: no memory for a %dx%d sprite\n", w, h);
+  return false;
+}
+
+// The face sprites all get the same font, blend tables and push mode
+static void setupFaceSprite(ClockSprite& face){
+  //face.setColorDepth(8); // 8 bit will work, but reduces effectiveness of anti-aliasing
+  createSprite(face, SCREEN_W, SCREEN_H);
+  face.loadFont("Futura-MediumItalic-18"); // prepare for analog updates afterwards
+  face.setKnownBackground(true);   // text is always drawn on the plain face
+  face.setBlendLut(&blend_lut);
+  // the face is opaque and round, only the circle is sent when the CPU pushes
+  face.setPushMode(ClockSprite::PUSH_CIRCLE);
+}
+
+void setupDisplays(){
+  displays.begin();
+  span_canvas.begin(displays, SPAN_FACE, SCREEN_W, SCREEN_H);
+  
+  // Initialize all displays on the main bus at once
+  displays.selectAll();
   // Initialise the screen
   tft.init();    
   // Ideally set orientation for good viewing angle range because
@@ -191,30 +416,264 @@ void setupDisplays(){
   // Usually this is when screen ribbon connector is at the bottom
   tft.setRotation(0);
   tft.fillScreen(TFT_BLACK);
-  for (int i=0; i < num_displays; i++){
-    digitalWrite(display_cs_pins[i],HIGH);
+  displays.release();
+
+#ifdef PANEL_BUS2_MOSI
+  // the second bus brings up its own panels
+  if (displays.busMask(1) && !second_bus.begin(&displays, 1, HSPI_HOST, PANEL_BUS2_MOSI, PANEL_BUS2_SCLK,
+                                               PANEL_BUS2_DC, PANEL_BUS2_RST, PANEL_BUS2_FREQUENCY)){
+    Serial.println("ERROR: second SPI bus init failed");
   }
-  digitalWrite(display_cs_pins[1], LOW);
-  tft.fillSmoothCircle( CLOCK_R-1, CLOCK_R-1, CLOCK_R, bg_colors[1] );
-  digitalWrite(display_cs_pins[1], HIGH);
+#endif
+  for (uint8_t i=0; i < displays.panelCount(); i++){
+    if (displays.panel(i).bus >= num_buses) Serial.printf("ERROR: panel on CS %d is on a bus that isn't set up\n", displays.panel(i).cs_pin);
+  }
+
+  // Sprites are kept in panel byte order and pushed untouched, with DMA
+  // when possible. DMA has to be set up before the sprites are created so
+  // TFT_eSPI puts them in normal RAM instead of PSRAM.
+  tft.setSwapBytes(false);
+  tft.initDMA();
+
+  for (uint16_t fg : aa_colors) {
+    for (uint8_t i=0; i < displays.panelCount(); i++) blend_lut.registerPair(fg, displays.panel(i).bg_color);
+  }
+  // Create the clock face sprites, the biggest ones first
+  for (uint8_t b=0; b < num_buses; b++){
+    if (displays.busMask(b)) setupFaceSprite(faceSprite(b));
+  }
+
+  // the digits are only ever copied into a face sprite, never pushed
+  createSprite(digital_face_minutes, SCREEN_W / 2, SCREEN_H / 2);
+  digital_face_minutes.loadFont("Mali-Bold-60");
+  digital_face_minutes.setKnownBackground(true);
+
+  createSprite(digital_face_hours, SCREEN_W / 2, SCREEN_H / 2);
+  digital_face_hours.loadFont("Mali-Bold-90");
+  digital_face_hours.setKnownBackground(true);
+
+  // from here on pushes are sent by the bus tasks
+  for (uint8_t b=0; b < num_buses; b++){
+    if (displays.busMask(b)) buses[b]->start(&displays, b ? "push bus 1" : "push bus 0");
+  }
+
+  // the digital face only redraws its digits, give it a round background
+  for (uint8_t g=0; g < displays.groupCount(); g++){
+    const PanelGroup& group = displays.group(g);
+    const Panel& panel = displays.panel(group.first);
+    hours_shown[group.first] = -1;
+    if (panel.face != DIGITAL_FACE || group.bus >= num_buses) continue;
+    ClockSprite& face = faceSprite(group.bus);
+    buses[group.bus]->wait();
+    face.fillSprite(TFT_BLACK);
+    face.fillSmoothCircle( CLOCK_R-1, CLOCK_R-1, CLOCK_R, panel.bg_color );
+    buses[group.bus]->submit(&face, 0, 0, group);
+  }
+  for (PanelBus* bus : buses) bus->wait();
 }
 
+#ifdef GOLDEN_FRAMES
 // =========================================================================
-// Setup
+// Golden frames
 // =========================================================================
-uint32_t targetTime = 0;    // Time for next tick
-void setup() {
-  Serial.begin(115200);
-  delay(500);
-  Serial.println("Booting...");
+// Both faces at the fixed times of GoldenFrames.h, dumped to Serial for
+// tools/golden_frames.py
+static void dumpGoldenFrames() {
+  ClockSprite& fb = analog_face;
+  if (!fb.created()) setupFaceSprite(fb);
+  for (uint8_t i = 0; i < GOLDEN_TIMES; i++){
+    for (uint8_t f = 0; f < GOLDEN_FACES; f++){
+      GoldenFace face = (GoldenFace)f;
+      drawGoldenFrame(fb, digital_face_hours, digital_face_minutes, face, golden_times[i].t);
+      dumpFrame(Serial, goldenFaceName(face), golden_times[i].name, fb);
+    }
+  }
+  Serial.println("\nGOLDEN_END");
+}
+#endif
 
-  if (!SPIFFS.begin()) {
-    Serial.println("SPIFFS initialisation failed!");
-    while (1) yield(); // Stay here twiddling thumbs waiting
+#ifdef PIXEL_HEATMAP
+// =========================================================================
+// Pixel heatmap
+// =========================================================================
+// How often each pixel is written and blended: an analog frame drawn from
+// scratch, the same frame with the dial cache warm, and the digital minutes.
+// tools/heatmap.py turns the dump into images and per primitive totals.
+static void dumpHeatmaps() {
+  static PixelHeat heat;
+  const day_us_t t = 10*US_PER_HOUR + 8*US_PER_MIN + 42500000;
+  ClockSprite& face = analog_face;
+  if (!face.created()) setupFaceSprite(face);
+
+  if (heat.begin(face.width(), face.height())){
+    face.setHeatmap(&heat);
+    face.clearDial();
+    drawAnalogFace(face, t, TFT_DARKGREEN);
+    heat.dump(Serial, "analog-cold");
+    heat.reset();
+    drawAnalogFace(face, t, TFT_DARKGREEN);
+    heat.dump(Serial, "analog-warm");
+    face.setHeatmap(nullptr);
   }
-  Serial.println("\r\nInitialisation done.");
 
-  // Connect to WiFi
+  if (heat.begin(digital_face_minutes.width(), digital_face_minutes.height())){
+    digital_face_minutes.setHeatmap(&heat);
+    drawDigitalMinutes(digital_face_minutes, t, TFT_BLUE);
+    heat.dump(Serial, "digital-minutes");
+    digital_face_minutes.setHeatmap(nullptr);
+  }
+  Serial.println("\nHEATMAP_END");
+}
+#endif
+
+#ifdef TIME_WARP
+// =========================================================================
+// Time warp
+// =========================================================================
+// Runs the faces through whole days TIME_WARP times faster than real time,
+// one with the spring DST change and one with the autumn one (the EU dates,
+// put in your own for other zones). Every frame checks that the time of
+// day the faces get follows the clock, jumping only at midnight and the
+// DST changes, and that the digital panels show the right hour. Each day
+// ends with a report of the slowest frames and when they happened.
+WarpClock warp_clock(TIME_WARP);
+
+static const time_t warp_days[] = {
+  1711836000,   // 2024-03-30 23:00 CET, clocks go forward at 02:00 next day
+  1729976400,   // 2024-10-26 23:00 CEST, clocks go back at 03:00 next day
+};
+#define WARP_HOURS 26
+
+struct WarpFrame {
+  uint32_t us;
+  time_t epoch;
+};
+
+static struct {
+  uint8_t day;
+  time_t last_epoch;
+  int last_secs;
+  bool last_dst;
+  uint32_t frames;
+  uint64_t total_us;
+  uint16_t errors;
+  WarpFrame slowest[3];
+} warp;
+
+static const char* warpTime(time_t t) {
+  static char out[12];
+  tm local;
+  localtime_r(&t, &local);
+  strftime(out, sizeof(out), "%H:%M:%S", &local);
+  return out;
+}
+
+static void warpStart(uint8_t day) {
+  memset(&warp, 0, sizeof(warp));
+  warp.day = day;
+  warp.last_secs = -1;
+  warp_clock.start(warp_days[day]);
+}
+
+static void warpBegin() {
+  setenv("TZ", tz_info, 1);
+  tzset();
+  clock_source = &warp_clock;
+  warpStart(0);
+  Serial.printf("WARP running at %gx\n", (double)TIME_WARP);
+}
+
+static void warpReport() {
+  char day[12];
+  tm local;
+  time_t start = warp_days[warp.day] + 3600;
+  localtime_r(&start, &local);
+  strftime(day, sizeof(day), "%Y-%m-%d", &local);
+  Serial.printf("WARP %s: %u frames, %.2f ms average, %u errors, slowest", day,
+                (unsigned)warp.frames, warp.frames ? warp.total_us / 1000.0 / warp.frames : 0.0, warp.errors);
+  for (const WarpFrame& f : warp.slowest) {
+    if (f.us) Serial.printf(" %.2f ms at %s", f.us / 1000.0, warpTime(f.epoch));
+  }
+  Serial.println();
+}
+
+// after the renders, frame_us is how long the frame took
+static void warpFrame(uint32_t frame_us, bool new_second) {
+  time_t epoch = warp_clock.epoch();
+  bool dst;
+  int day_secs = local_zone.daySeconds(epoch, &dst);
+
+  if (warp.last_secs >= 0) {
+    // how far the time of day moved, less how far the clock moved
+    long step = day_secs - warp.last_secs - (long)(epoch - warp.last_epoch);
+    const char* why = nullptr;
+    if (step == -86400) why = "midnight";
+    else if ((step == 3600 || step == -3600) && dst != warp.last_dst) why = "DST change";
+    else if (step) why = "ERROR: unexpected jump";
+    if (why) {
+      Serial.printf("WARP %02d:%02d:%02d -> %s %s\n", warp.last_secs / 3600, warp.last_secs / 60 % 60,
+                    warp.last_secs % 60, warpTime(epoch), why);
+      if (why[0] == 'E') warp.errors++;
+    }
+  }
+  // the cached zone against newlib's reading of the same TZ string
+  tm check;
+  localtime_r(&epoch, &check);
+  if (check.tm_hour*3600 + check.tm_min*60 + check.tm_sec != day_secs || (check.tm_isdst > 0) != dst) {
+    Serial.printf("WARP ERROR: %s local, the zone says %02d:%02d:%02d%s\n", warpTime(epoch),
+                  day_secs / 3600, day_secs / 60 % 60, day_secs % 60, dst ? " DST" : "");
+    warp.errors++;
+  }
+
+  warp.last_epoch = epoch;
+  warp.last_secs = day_secs;
+  warp.last_dst = dst;
+
+  // the hour on every digital panel after its once a second update
+  for (uint8_t g = 0; new_second && g < displays.groupCount(); g++) {
+    const PanelGroup& group = displays.group(g);
+    if (group.bus >= num_buses || displays.panel(group.first).face != DIGITAL_FACE) continue;
+    if (hours_shown[group.first] != panel_zones[group.first].daySeconds(epoch) / 3600) {
+      Serial.printf("WARP ERROR: panel %d shows hour %d at %s\n", group.first, hours_shown[group.first], warpTime(epoch));
+      warp.errors++;
+    }
+  }
+
+  warp.frames++;
+  warp.total_us += frame_us;
+  for (uint8_t i = 0; i < 3; i++) {
+    if (frame_us <= warp.slowest[i].us) continue;
+    for (uint8_t j = 2; j > i; j--) warp.slowest[j] = warp.slowest[j - 1];
+    warp.slowest[i] = {frame_us, epoch};
+    break;
+  }
+
+  if (epoch - warp_days[warp.day] >= WARP_HOURS * 3600) {
+    warpReport();
+    warpStart((warp.day + 1) % (sizeof(warp_days) / sizeof(warp_days[0])));
+  }
+}
+#endif
+
+// =========================================================================
+// Network and keeping the clock
+// =========================================================================
+// WiFi, NTP and the peers come up in a task of their own, the faces don't
+// wait for them: after a reset the clock is already right (ClockMemory),
+// after power on it shows 1970 until the first sync. WiFiManager's portal
+// can hold that task for good, so slewing the drift in and saving it has a
+// small task of its own that starts first.
+#define KEEP_S 16
+
+static void keepTask(void*) {
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(KEEP_S * 1000));
+    clock_discipline.tick();
+    clock_memory.save(clock_discipline);
+  }
+}
+
+static void networkTask(void*) {
   if (wifiTimeLib.connectToWiFi("ESP32-Clock")){
     delay(500);
     Serial.println("getting current time...");
@@ -224,12 +683,91 @@ void setup() {
     } else {
       Serial.println("Error: NTP time update failed!");
     }
+    // keeps syncing, also after a failed first one
+    if (!ntp_client.start(NTP_POLL)) Serial.println("ERROR: no NTP task, the clock is only set once");
+#ifdef PEER_SYNC
+    // the MAC without the vendor part, unique on the LAN
+    if (!peer_sync.begin((uint32_t)(ESP.getEfuseMac() >> 16)) || !peer_sync.start()){
+      Serial.println("ERROR: peer sync didn't start, following NTP on our own");
+    }
+#endif
   } else {
     Serial.println("ERROR: WiFi connect failure");
   }
+  vTaskDelete(nullptr);
+}
+
+static void startNetwork() {
+  BaseType_t core = otherCore();
+  if (xTaskCreatePinnedToCore(keepTask, "keep clock", 4096, nullptr, 1, nullptr, core) != pdPASS){
+    Serial.println("ERROR: no task to keep the clock, drift isn't corrected or saved");
+  }
+  if (xTaskCreatePinnedToCore(networkTask, "network", 8192, nullptr, 1, nullptr, core) != pdPASS){
+    Serial.println("ERROR: no network task, the clock won't be set");
+  }
+}
+
+// =========================================================================
+// Setup
+// =========================================================================
+uint32_t targetTime = 0;    // Time for next tick
+void setup() {
+  Serial.begin(115200);
+  delay(500);
+  Serial.println("Booting...");
+#ifdef TIMELINE
+  timeline.begin(profile_names, EVENTS);
+#endif
+
+  if (!SPIFFS.begin()) {
+    Serial.println("SPIFFS initialisation failed!");
+    while (1) yield(); // Stay here twiddling thumbs waiting
+  }
+  Serial.println("\r\nInitialisation done.");
+
+  if (!local_zone.parse(tz_info)) Serial.printf("ERROR: can't read the timezone %s, showing UTC\n", tz_info);
+  for (uint8_t i = 0; i < num_displays; i++){
+    panel_zones[i] = local_zone;
+    if (panels[i].tz && !panel_zones[i].parse(panels[i].tz)) Serial.printf("ERROR: can't read the timezone %s\n", panels[i].tz);
+  }
+
+  // the clock may have kept running through a reset
+  if (clock_memory.resume(&clock_discipline)) {
+    Serial.println("Clock resumed from before the reset");
+    if (clock_memory.lastSync()) Serial.printf("Last synced %ld min ago, drift %+.2f ppm\n",
+                                               (long)(time(nullptr) - clock_memory.lastSync()) / 60, (double)clock_discipline.drift());
+  } else {
+    // after power on the clock is back in 1970, only the drift is known
+    Serial.println("Clock not set, waiting for NTP");
+    if (clock_memory.lastSync()) Serial.printf("Drift %+.2f ppm from the last run\n", (double)clock_discipline.drift());
+  }
 
   setupDisplays();
 
+#ifdef CLOCK_BENCHMARKS
+  runBenchmarks();
+#endif
+
+#ifdef GOLDEN_FRAMES
+  dumpGoldenFrames();
+#endif
+
+#ifdef PIXEL_HEATMAP
+  dumpHeatmaps();
+#endif
+
+#ifdef TIME_WARP
+  warpBegin();
+#endif
+
+#ifdef SPI_TRACE
+  // record the first SPI_TRACE frames, dumped to Serial when done
+  if (!spi_trace.begin(SPI_TRACE, SCREEN_W, SCREEN_H)) Serial.println("ERROR: no memory for the SPI trace");
+#endif
+
+  startDigitalTask();
+  startNetwork();
+
   targetTime = millis();
 }
 
@@ -238,49 +776,95 @@ void setup() {
 // =========================================================================
 int fps=18;                 // frame rate counter, start val is an estimate
 float avg_fps=18.0;         // running average across 2 loop samples
-float time_secs;            // time in seconds+ms sent to rendering functions
-int last_second = 0;        // for checking when to update the digital clock
-int ms_offset = 0;          // offset of millis() since start of the last sec
+time_t last_second = 0;     // for checking when to update the digital clock
 
 void loop() {
   long m = millis();
   if (targetTime < m) {   
     // schedule next tick time for smoother movement
     targetTime = m +  3;
+    PROFILE_ZONE(ZONE_FRAME);
+#ifdef TIME_WARP
+    uint32_t frame_start = micros();
+#endif
+
+#ifdef SPI_TRACE
+    // let the last frame's pushes land before this frame's marker
+    for (PanelBus* bus : buses) bus->wait();
+    spi_trace.frame();
+#endif
 
     // Update time periodically
-    time(&now);
-    localtime_r(&now, &timeinfo);
-    int secs = timeinfo.tm_sec;
-    time_secs = timeinfo.tm_hour*3600
-              + timeinfo.tm_min*60 
-              + secs;
-
-    if (secs != last_second){ 
-      ms_offset = m;
-      last_second = secs;
-
-      // digital clock
-      digitalWrite(display_cs_pins[1], LOW);
-      renderDigitalFace(time_secs, bg_colors[1]);
-      digitalWrite(display_cs_pins[1], HIGH);
-    } 
-
-    // analog clock
-    digitalWrite(display_cs_pins[0], LOW);
-    renderAnalogFace(time_secs + (millis()-ms_offset)/1000.0, bg_colors[0]);
-    digitalWrite(display_cs_pins[0], HIGH);
+    time_t utc;
+    uint32_t us;
+    {
+      PROFILE_ZONE(ZONE_TIME);
+      clock_source->now(&utc, &us);
+      frame_read_us = micros();
+    }
+
+    bool new_second = utc != last_second;
+    last_second = utc;
+
+    // each group is one panel, or several mirrored ones sharing a render.
+    // All of them get the same clock reading, in their panel's timezone
+    for (uint8_t g=0; g < displays.groupCount(); g++){
+      const PanelGroup& group = displays.group(g);
+      if (group.bus >= num_buses) continue;
+      day_us_t time_us = panel_zones[group.first].daySeconds(utc) * US_PER_SEC + us;
+      switch (displays.panel(group.first).face){
+        case DIGITAL_FACE:
+          // digital clock, once a second
+          if (new_second && !digital_on_tick) renderDigitalFace(time_us, group);
+          break;
+        case ANALOG_FACE:
+          renderAnalogFace(time_us, group);
+          break;
+        case SPAN_FACE:
+          renderSpanFace(time_us, group);
+          break;
+      }
+    }
+
+#ifdef TIME_WARP
+    warpFrame(micros() - frame_start, new_second);
+#endif
 
     // Keep track of frame rate and use it to keep the animation consistent
     fps++;
 
     if (millis() % 3000 == 0){
         // report FPS every 3 seconds
+        PROFILE_ZONE(ZONE_SERIAL);
         Serial.print(" FPS > ");
         Serial.println(fps);
+        if (digital_on_tick) Serial.printf(" second tick late by up to %u us\n", (unsigned)second_ticker.maxLate());
+        uint32_t ahead = 0;
+        for (uint8_t g=0; g < displays.groupCount(); g++) ahead = max(ahead, frame_latency[displays.group(g).first].average());
+        Serial.printf(" hands drawn up to %u us ahead\n", (unsigned)ahead);
         avg_fps = (avg_fps + fps)/2;
         fps = 0;
     }
 
+    if (ntp_client.syncs() != ntp_reported){
+        PROFILE_ZONE(ZONE_SERIAL);
+        ntp_reported = ntp_client.syncs();
+        ntp_client.printStats();
+    }
+#ifdef PEER_SYNC
+    if (peer_sync.changes() != peer_reported){
+        PROFILE_ZONE(ZONE_SERIAL);
+        peer_reported = peer_sync.changes();
+        peer_sync.printStats();
+    }
+#endif
+
+#ifdef PROFILER
+    profiler.tick();
+#endif
+#ifdef TIMELINE
+    timeline.drain();
+#endif
+
   }
 }
\ No newline at end of file
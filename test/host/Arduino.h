@@ -0,0 +1,112 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Enough of the Arduino core and FreeRTOS for the sources [env:native]
+// builds, header only. Serial writes to stdout, tasks are threads, the
+// clocks are in HostClock.h.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include "HostClock.h"
+
+#define PROGMEM
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+
+using std::min;
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+class String : public std::string {
+public:
+    String(const char* s = "") : std::string(s) {}
+    String(const std::string& s) : std::string(s) {}
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t println(const char* s = "") { return print(s) + print('\n'); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(nullptr, 0, format, args);
+        va_end(args);
+        std::vector<char> text(len + 1);
+        va_start(args, format);
+        vsnprintf(text.data(), text.size(), format, args);
+        va_end(args);
+        return write((const uint8_t*)text.data(), len);
+    }
+};
+
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    using Print::write;
+    size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+    int availableForWrite() { return 128; }
+    void flush() override { fflush(stdout); }
+};
+inline HardwareSerial Serial;
+
+// 32 bits like on the board, they wrap the same way
+inline uint32_t micros() { return (uint32_t)hostMonotonicUs(); }
+inline uint32_t millis() { return (uint32_t)(hostMonotonicUs() / 1000); }
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void yield() {}
+
+inline char* ltoa(long value, char* str, int base) {
+    char digits[sizeof(long) * 8 + 1];
+    unsigned long v = value < 0 && base == 10 ? -(unsigned long)value : (unsigned long)value;
+    int n = 0;
+    do {
+        digits[n++] = "0123456789abcdefghijklmnopqrstuvwxyz"[v % base];
+        v /= base;
+    } while (v);
+    char* out = str;
+    if (value < 0 && base == 10) *out++ = '-';
+    while (n) *out++ = digits[--n];
+    *out = 0;
+    return str;
+}
+
+// FreeRTOS: a tick is a millisecond, a task a detached thread, and
+// everything runs on the loop's core as far as the code can tell
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+#define pdPASS 1
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+inline BaseType_t xPortGetCoreID() { return 1; }
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
+inline BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char*, uint32_t, void* arg, unsigned,
+                                          TaskHandle_t* handle, BaseType_t) {
+    std::thread(task, arg).detach();
+    if (handle) *handle = nullptr;
+    return pdPASS;
+}
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,61 @@
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+// The clocks of the native build. micros(), millis() and
+// esp_timer_get_time() count from the start of the program. The system
+// clock is one per thread, so a test can run several clocks in one
+// process, each set and slewed on its own: gettimeofday(), settimeofday()
+// and adjtime() are redirected to it. It reads the host's time plus
+// offset_us, gaining rate_ppm, and adjtime() moves it at once instead of
+// slewing.
+#include <stdint.h>
+#include <time.h>
+#include <sys/time.h>
+#include <chrono>
+
+struct HostClock {
+    int64_t offset_us = 0;
+    double rate_ppm = 0;
+    int64_t frozen_us = -1;   // when >= 0, micros() and co. stand still at this
+};
+inline thread_local HostClock host_clock;
+
+inline int64_t hostElapsedUs() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline int64_t hostMonotonicUs() {
+    return host_clock.frozen_us >= 0 ? host_clock.frozen_us : hostElapsedUs();
+}
+
+inline int64_t hostWallUs() {
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    int64_t us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec + host_clock.offset_us;
+    return us + (int64_t)(hostElapsedUs() * host_clock.rate_ppm / 1e6);
+}
+
+inline int host_gettimeofday(timeval* tv, void*) {
+    int64_t us = hostWallUs();
+    tv->tv_sec = us / 1000000;
+    tv->tv_usec = us % 1000000;
+    return 0;
+}
+
+inline int host_settimeofday(const timeval* tv, const void*) {
+    host_clock.offset_us += (int64_t)tv->tv_sec * 1000000 + tv->tv_usec - hostWallUs();
+    return 0;
+}
+
+inline int host_adjtime(const timeval* delta, timeval* olddelta) {
+    if (delta) host_clock.offset_us += (int64_t)delta->tv_sec * 1000000 + delta->tv_usec;
+    if (olddelta) *olddelta = {0, 0};
+    return 0;
+}
+
+#define gettimeofday host_gettimeofday
+#define settimeofday host_settimeofday
+#define adjtime      host_adjtime
+
+#endif // HOST_CLOCK_H
@@ -0,0 +1,326 @@
+#ifndef HOST_TFT_ESPI_H
+#define HOST_TFT_ESPI_H
+
+// Enough of TFT_eSPI for ClockSprite and the faces on the host, header
+// only: 16 bit sprites in memory, stored in panel byte order like the
+// library does, its alphaBlend(), and smooth fonts read from the .vlw files
+// in data/ (what goes into SPIFFS on the board). There is no panel, pushes
+// go nowhere. The library drawing that ClockSprite replaces isn't here, a
+// call that would end up in it stops the test.
+#include <Arduino.h>
+
+#ifndef TFT_WIDTH
+#define TFT_WIDTH  240
+#define TFT_HEIGHT 240
+#endif
+
+#define TFT_BLACK       0x0000
+#define TFT_NAVY        0x000F
+#define TFT_DARKGREEN   0x03E0
+#define TFT_DARKCYAN    0x03EF
+#define TFT_MAROON      0x7800
+#define TFT_PURPLE      0x780F
+#define TFT_OLIVE       0x7BE0
+#define TFT_LIGHTGREY   0xD69A
+#define TFT_DARKGREY    0x7BEF
+#define TFT_BLUE        0x001F
+#define TFT_GREEN       0x07E0
+#define TFT_CYAN        0x07FF
+#define TFT_RED         0xF800
+#define TFT_MAGENTA     0xF81F
+#define TFT_YELLOW      0xFFE0
+#define TFT_WHITE       0xFFFF
+#define TFT_ORANGE      0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_PINK        0xFE19
+#define TFT_BROWN       0x9A60
+#define TFT_GOLD        0xFEA0
+#define TFT_SILVER      0xC618
+#define TFT_SKYBLUE     0x867D
+#define TFT_VIOLET      0x915C
+#define TFT_TRANSPARENT 0x0120
+
+#define TL_DATUM    0
+#define TC_DATUM    1
+#define TR_DATUM    2
+#define ML_DATUM    3
+#define CL_DATUM    3
+#define MC_DATUM    4
+#define CC_DATUM    4
+#define MR_DATUM    5
+#define CR_DATUM    5
+#define BL_DATUM    6
+#define BC_DATUM    7
+#define BR_DATUM    8
+#define L_BASELINE  9
+#define C_BASELINE 10
+#define R_BASELINE 11
+
+inline void hostUnsupported(const char* what) {
+    fprintf(stderr, "host TFT_eSPI: %s isn't in the host build\n", what);
+    abort();
+}
+
+class TFT_eSPI {
+public:
+    TFT_eSPI(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT) : _width(w), _height(h) {}
+    virtual ~TFT_eSPI() { unloadFont(); }
+
+    virtual void drawPixel(int32_t, int32_t, uint32_t) {}
+    virtual void drawFastHLine(int32_t, int32_t, int32_t, uint32_t) {}
+    virtual void drawFastVLine(int32_t, int32_t, int32_t, uint32_t) {}
+    virtual void fillRect(int32_t, int32_t, int32_t, int32_t, uint32_t) {}
+    virtual int16_t width() { return _width; }
+    virtual int16_t height() { return _height; }
+
+    void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+        drawFastHLine(x, y, w, color);
+        drawFastHLine(x, y + h - 1, w, color);
+        drawFastVLine(x, y + 1, h - 2, color);
+        drawFastVLine(x + w - 1, y + 1, h - 2, color);
+    }
+
+    // the panel side, nothing is sent
+    bool initDMA(bool = false) { return false; }
+    void deInitDMA() {}
+    void setSwapBytes(bool swap) { _swapBytes = swap; }
+    bool getSwapBytes() { return _swapBytes; }
+    void startWrite() {}
+    void endWrite() {}
+    void setAddrWindow(int32_t, int32_t, int32_t, int32_t) {}
+    void pushPixels(const void*, uint32_t) {}
+    void pushImageDMA(int32_t, int32_t, int32_t, int32_t, uint16_t*, uint16_t* = nullptr) {}
+    void dmaWait() {}
+
+    void setCursor(int16_t x, int16_t y) {
+        cursor_x = x;
+        cursor_y = y;
+    }
+    void setTextColor(uint16_t color) {
+        textcolor = textbgcolor = color;
+        _fillbg = false;
+    }
+    void setTextColor(uint16_t fg, uint16_t bg, bool bgfill = false) {
+        textcolor = fg;
+        textbgcolor = bg;
+        _fillbg = bgfill;
+    }
+    void setTextDatum(uint8_t datum) { textdatum = datum; }
+    uint8_t getTextDatum() { return textdatum; }
+
+    // the library's, red and blue blended at 6 bits, green at 8
+    uint16_t alphaBlend(uint8_t alpha, uint16_t fgc, uint16_t bgc, uint8_t = 0) {
+        uint32_t rxb = bgc & 0xF81F;
+        rxb += ((fgc & 0xF81F) - rxb) * (alpha >> 2) >> 6;
+        uint32_t xgx = bgc & 0x07E0;
+        xgx += ((fgc & 0x07E0) - xgx) * alpha >> 8;
+        return (rxb & 0xF81F) | (xgx & 0x07E0);
+    }
+
+    uint16_t decodeUTF8(uint8_t* buf, uint16_t* index, uint16_t remaining) {
+        uint16_t c = buf[(*index)++];
+        if ((c & 0x80) == 0x00) return c;
+        if ((c & 0xE0) == 0xC0 && remaining > 1) return ((c & 0x1F) << 6) | (buf[(*index)++] & 0x3F);
+        if ((c & 0xF0) == 0xE0 && remaining > 2) {
+            c = ((c & 0x0F) << 12) | ((buf[(*index)++] & 0x3F) << 6);
+            return c | (buf[(*index)++] & 0x3F);
+        }
+        return c;
+    }
+
+    // data/<name>.vlw, relative to the project, where pio test runs
+    void loadFont(String name) {
+        unloadFont();
+        FILE* f = fopen(("data/" + name + ".vlw").c_str(), "rb");
+        if (!f) return;
+        std::vector<uint8_t> data;
+        uint8_t buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+        fclose(f);
+        font_file.swap(data);
+        loadMetrics(font_file.data());
+    }
+
+    void loadFont(const uint8_t array[]) {
+        unloadFont();
+        loadMetrics(array);
+    }
+
+    void unloadFont() {
+        free(gUnicode);
+        free(gHeight);
+        free(gWidth);
+        free(gxAdvance);
+        free(gdY);
+        free(gdX);
+        free(gBitmap);
+        gUnicode = nullptr;
+        gHeight = gWidth = gxAdvance = nullptr;
+        gdY = nullptr;
+        gdX = nullptr;
+        gBitmap = nullptr;
+        gFont.gArray = nullptr;
+        std::vector<uint8_t>().swap(font_file);
+        fontLoaded = false;
+    }
+
+    virtual void drawGlyph(uint16_t) { hostUnsupported("drawGlyph()"); }
+    int16_t drawString(const char*, int32_t, int32_t) {
+        hostUnsupported("drawString() without a smooth font");
+        return 0;
+    }
+    int16_t drawNumber(long n, int32_t x, int32_t y) {
+        char str[12];
+        ltoa(n, str, 10);
+        return drawString(str, x, y);
+    }
+    int16_t textWidth(const char*) {
+        hostUnsupported("textWidth() without a smooth font");
+        return 0;
+    }
+
+    struct fontMetrics {
+        const uint8_t* gArray;
+        uint16_t gCount;
+        uint16_t yAdvance;
+        uint16_t spaceWidth;
+        int16_t ascent;
+        int16_t descent;
+        uint16_t maxAscent;
+        uint16_t maxDescent;
+    };
+    fontMetrics gFont = {nullptr, 0, 0, 0, 0, 0, 0, 0};
+    uint16_t* gUnicode = nullptr;
+    uint8_t* gHeight = nullptr;
+    uint8_t* gWidth = nullptr;
+    uint8_t* gxAdvance = nullptr;
+    int16_t* gdY = nullptr;
+    int8_t* gdX = nullptr;
+    uint32_t* gBitmap = nullptr;
+    bool fontLoaded = false;
+
+    bool DMA_Enabled = false;
+    uint32_t textcolor = 0xFFFF, textbgcolor = 0;
+    uint8_t textdatum = TL_DATUM;
+
+protected:
+    int32_t _width, _height;
+    int32_t cursor_x = 0, cursor_y = 0, padX = 0, bg_cursor_x = 0, last_cursor_x = 0;
+    bool isDigits = false, textwrapX = false, textwrapY = false, _swapBytes = false;
+    bool _fillbg = false;
+
+private:
+    // Same as the library: a 24 byte header, 28 bytes per glyph, then the
+    // bitmaps, all big endian
+    void loadMetrics(const uint8_t* array) {
+        gFont.gArray = array;
+        uint32_t pos = 0;
+        auto next = [&]() {
+            uint32_t v = (uint32_t)array[pos] << 24 | array[pos + 1] << 16 | array[pos + 2] << 8 | array[pos + 3];
+            pos += 4;
+            return v;
+        };
+        gFont.gCount = next();
+        next();   // encoder version
+        gFont.yAdvance = next();
+        next();
+        gFont.ascent = next();
+        gFont.descent = next();
+        gFont.maxAscent = gFont.ascent;
+        gFont.maxDescent = gFont.descent;
+
+        uint16_t count = gFont.gCount;
+        gUnicode = (uint16_t*)malloc(count * 2);
+        gHeight = (uint8_t*)malloc(count);
+        gWidth = (uint8_t*)malloc(count);
+        gxAdvance = (uint8_t*)malloc(count);
+        gdY = (int16_t*)malloc(count * 2);
+        gdX = (int8_t*)malloc(count);
+        gBitmap = (uint32_t*)malloc(count * 4);
+
+        uint32_t bitmap = 24 + count * 28;
+        for (uint16_t i = 0; i < count; i++) {
+            gUnicode[i] = next();
+            gHeight[i] = next();
+            gWidth[i] = next();
+            gxAdvance[i] = next();
+            gdY[i] = next();
+            gdX[i] = next();
+            next();
+            // printable glyphs only, the rest give odd values
+            if ((gUnicode[i] > 0x20 && gUnicode[i] < 0x7F) || gUnicode[i] > 0xA0) {
+                if (gdY[i] > gFont.maxAscent) gFont.maxAscent = gdY[i];
+                if ((int16_t)gHeight[i] - gdY[i] > gFont.maxDescent) gFont.maxDescent = gHeight[i] - gdY[i];
+            }
+            gBitmap[i] = bitmap;
+            bitmap += gWidth[i] * gHeight[i];
+        }
+        gFont.yAdvance = gFont.maxAscent + gFont.maxDescent;
+        gFont.spaceWidth = (gFont.ascent + gFont.descent) * 2 / 7;
+        fontLoaded = true;
+    }
+
+    std::vector<uint8_t> font_file;
+};
+
+class TFT_eSprite : public TFT_eSPI {
+public:
+    explicit TFT_eSprite(TFT_eSPI* tft) : _tft(tft) {}
+    ~TFT_eSprite() { deleteSprite(); }
+
+    void* createSprite(int16_t w, int16_t h, uint8_t = 1) {
+        if (_created) return _img;
+        _img = (uint16_t*)calloc(w * h, 2);
+        if (!_img) return nullptr;
+        _iwidth = w;
+        _iheight = h;
+        _created = true;
+        return _img;
+    }
+    void deleteSprite() {
+        free(_img);
+        _img = nullptr;
+        _created = false;
+    }
+    bool created() { return _created; }
+    void* getPointer() { return _img; }
+    int16_t width() override { return _iwidth; }
+    int16_t height() override { return _iheight; }
+
+    // colours are stored byte swapped, ready for the panel
+    void drawPixel(int32_t x, int32_t y, uint32_t color) override {
+        if (x < 0 || y < 0 || x >= _iwidth || y >= _iheight) return;
+        _img[x + y * _iwidth] = (uint16_t)(color >> 8 | color << 8);
+    }
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) override {
+        for (int32_t row = y; row < y + h; row++) {
+            for (int32_t col = x; col < x + w; col++) drawPixel(col, row, color);
+        }
+    }
+    void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) override { fillRect(x, y, w, 1, color); }
+    void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) override { fillRect(x, y, 1, h, color); }
+    void fillSprite(uint32_t color) { fillRect(0, 0, _iwidth, _iheight, color); }
+
+    void drawWideLine(float, float, float, float, float, uint32_t, uint32_t = 0x00FFFFFF) {
+        hostUnsupported("drawWideLine()");
+    }
+    void drawWedgeLine(float, float, float, float, float, float, uint32_t, uint32_t = 0x00FFFFFF) {
+        hostUnsupported("drawWedgeLine()");
+    }
+    void fillSmoothCircle(int32_t, int32_t, int32_t, uint32_t, uint32_t = 0x00FFFFFF) {
+        hostUnsupported("fillSmoothCircle()");
+    }
+
+    void pushSprite(int32_t, int32_t) {}
+    void pushSprite(int32_t, int32_t, uint16_t) {}
+
+protected:
+    uint8_t _bpp = 16;
+    uint16_t* _img = nullptr;
+    bool _created = false;
+    int32_t _iwidth = 0, _iheight = 0;
+    TFT_eSPI* _tft;
+};
+
+#endif // HOST_TFT_ESPI_H
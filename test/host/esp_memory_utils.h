@@ -0,0 +1,7 @@
+#ifndef HOST_ESP_MEMORY_UTILS_H
+#define HOST_ESP_MEMORY_UTILS_H
+
+// no DMA on the host, pushes take the CPU path (and go nowhere)
+inline bool esp_ptr_dma_capable(const void*) { return false; }
+
+#endif // HOST_ESP_MEMORY_UTILS_H
@@ -0,0 +1,8 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include "HostClock.h"
+
+inline int64_t esp_timer_get_time() { return hostMonotonicUs(); }
+
+#endif // HOST_ESP_TIMER_H
@@ -0,0 +1,118 @@
+// The time the faces are drawn for, on the host:
+//     pio test -e native
+// The fixed point hand angles and the Q15 sine table against double
+// precision math, and WarpClock through the two DST days -D TIME_WARP
+// runs on the board: the time of day may only jump at midnight and at
+// the DST change, with micros() wrapping on the way.
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "ClockSource.h"
+#include "TimeZone.h"
+
+static const double R = 120;   // the face radius, errors are in pixels at the rim
+
+static double turnPx(double turns) {
+    return fabs(turns) * 2 * M_PI * R;
+}
+
+static void test_hand_turn() {
+    const int64_t periods[] = {US_PER_MIN, US_PER_HOUR, 12 * US_PER_HOUR};
+    char what[64];
+    for (int64_t period : periods) {
+        double worst = 0;
+        for (day_us_t t = -US_PER_DAY; t < 2 * US_PER_DAY; t += 7777777) {
+            double exact = fmod((double)t / period, 1.0);
+            if (exact < 0) exact += 1;
+            double diff = handTurn(t, period) / 4294967296.0 - exact;
+            diff -= round(diff);   // 0.9999 against 0.0 is next to it
+            worst = fmax(worst, turnPx(diff));
+        }
+        snprintf(what, sizeof(what), "period %lld us, %.6f px off", (long long)period, worst);
+        TEST_ASSERT_TRUE_MESSAGE(worst < 0.001, what);
+    }
+    // where the numerals go
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0x40000000u, TURN(3, 12), "3 o'clock");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, handTurn(12 * US_PER_HOUR, 12 * US_PER_HOUR), "noon");
+}
+
+static void test_sin_turn() {
+    double worst = 0;
+    for (uint64_t a = 0; a < (1ull << 32); a += 65521) {
+        double angle = a / 4294967296.0 * 2 * M_PI;
+        worst = fmax(worst, fabs(sinTurn((turn_t)a) - 32767 * sin(angle)));
+        worst = fmax(worst, fabs(cosTurn((turn_t)a) - 32767 * cos(angle)));
+    }
+    char what[64];
+    snprintf(what, sizeof(what), "%.2f off, %.4f px", worst, worst / 32767 * R);
+    TEST_ASSERT_TRUE_MESSAGE(worst / 32767 * R < 0.01, what);
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(32767, sinTurn(TURN(1, 4)), "sin 90");
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(-32767, cosTurn(TURN(1, 2)), "cos 180");
+}
+
+// The days main.cpp warps through, 23:00 local the day before the change
+static const time_t warp_days[] = {1711836000, 1729976400};
+static const char* const ZONE = "CET-1CEST,M3.5.0,M10.5.0/3";
+static const float SPEED = 720;
+static const int64_t FRAME_US = 40000;   // real time per frame
+
+static void warpDay(time_t from, int expect_dst_step) {
+    TimeZone zone;
+    zone.parse(ZONE);
+    WarpClock clock(SPEED);
+    // micros() wraps a few simulated hours in
+    host_clock.frozen_us = 0xFFFFFFFFll - 5 * US_PER_SEC;
+    clock.start(from);
+
+    int midnights = 0, dst_changes = 0;
+    time_t last_epoch = 0;
+    int last_secs = -1;
+    bool last_dst = false;
+    char what[80];
+    for (int64_t real = 0; real < 26 * US_PER_HOUR / SPEED; real += FRAME_US) {
+        host_clock.frozen_us += FRAME_US;
+        time_t utc;
+        uint32_t us;
+        clock.now(&utc, &us);
+        snprintf(what, sizeof(what), "%lld us after the start", (long long)real);
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(from + (time_t)((real + FRAME_US) * (double)SPEED / US_PER_SEC), utc, what);
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(utc, clock.epoch(), what);
+
+        bool dst;
+        int secs = zone.daySeconds(utc, &dst);
+        if (last_secs >= 0) {
+            // how far the time of day moved, less how far the clock moved
+            long step = secs - last_secs - (long)(utc - last_epoch);
+            if (step == -86400) midnights++;
+            else if (step == expect_dst_step && dst != last_dst) dst_changes++;
+            else TEST_ASSERT_EQUAL_INT32_MESSAGE(0, step, what);
+        }
+        last_epoch = utc;
+        last_secs = secs;
+        last_dst = dst;
+    }
+    host_clock.frozen_us = -1;
+    // 26 hours from 23:00 go past midnight twice
+    TEST_ASSERT_EQUAL_MESSAGE(2, midnights, "midnights");
+    TEST_ASSERT_EQUAL_MESSAGE(1, dst_changes, "DST changes");
+}
+
+static void test_warp_spring() {
+    warpDay(warp_days[0], 3600);
+}
+
+static void test_warp_autumn() {
+    warpDay(warp_days[1], -3600);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_hand_turn);
+    RUN_TEST(test_sin_turn);
+    RUN_TEST(test_warp_spring);
+    RUN_TEST(test_warp_autumn);
+    return UNITY_END();
+}
@@ -0,0 +1,174 @@
+// The faces drawn on the host against the golden frames:
+//     pio test -e native
+// Both faces are drawn at every golden time (GoldenFrames.h) with the real
+// fonts from data/ and the same blend tables the board registers, then
+// compared with test/test_faces/golden.bin, the same frames a -D
+// GOLDEN_FRAMES build dumps. A pixel may be one 5 bit step off in a
+// channel (9 of 255): the host and the ESP32 round the float edge
+// distances a little differently.
+//
+// When a frame is off, everything drawn here is written to
+// golden_diff/faces.bin for tools/golden_frames.py, which shows where:
+//     python tools/golden_frames.py golden_diff/faces.bin
+// and once the change is known to be the one intended, stores it:
+//     python tools/golden_frames.py golden_diff/faces.bin --update
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "GoldenFrames.h"
+
+static const char* const GOLDEN = "test/test_faces/golden.bin";
+static const char* const DIFF = "golden_diff/faces.bin";
+static const int TOLERANCE = 9;
+
+static TFT_eSPI tft;
+static ClockSprite face(&tft);
+static ClockSprite hours(&tft);
+static ClockSprite minutes(&tft);
+static BlendLut blend_lut;
+
+struct Frame {
+    int w, h;
+    std::vector<uint16_t> px;
+};
+static std::map<std::string, Frame> golden;
+
+class FilePrint : public Print {
+public:
+    explicit FilePrint(FILE* f) : f(f) {}
+    size_t write(uint8_t c) override { return fwrite(&c, 1, 1, f); }
+    size_t write(const uint8_t* buf, size_t n) override { return fwrite(buf, 1, n, f); }
+private:
+    FILE* f;
+};
+
+// the frames in a dump, like parse() in tools/golden_frames.py
+static void readGolden() {
+    FILE* f = fopen(GOLDEN, "rb");
+    if (!f) return;
+    std::vector<char> raw;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) raw.insert(raw.end(), buf, buf + n);
+    fclose(f);
+    raw.push_back(0);
+
+    const char* pos = raw.data();
+    const char* end = raw.data() + raw.size() - 1;
+    while ((pos = strstr(pos, "GOLDEN ")) != nullptr) {
+        char name[64];
+        int w, h, size, used;
+        if (sscanf(pos, "GOLDEN %63s %d %d %d\n%n", name, &w, &h, &size, &used) != 4) break;
+        pos += used;
+        if (pos + size > end) break;
+        Frame frame = {w, h, {}};
+        for (int i = 0; i < size; i += 4) {
+            const uint8_t* run = (const uint8_t*)pos + i;
+            frame.px.insert(frame.px.end(), run[0] | run[1] << 8, run[2] | run[3] << 8);
+        }
+        golden[name] = frame;
+        pos += size;
+    }
+}
+
+// largest 8 bit channel difference, panel order RGB565 expanded like to_rgb()
+static int difference(uint16_t a, uint16_t b) {
+    a = a << 8 | a >> 8;
+    b = b << 8 | b >> 8;
+    int dr = abs((a >> 11) * 255 / 31 - (b >> 11) * 255 / 31);
+    int dg = abs((a >> 5 & 0x3F) * 255 / 63 - (b >> 5 & 0x3F) * 255 / 63);
+    int db = abs((a & 0x1F) * 255 / 31 - (b & 0x1F) * 255 / 31);
+    return dr > dg ? (dr > db ? dr : db) : (dg > db ? dg : db);
+}
+
+// pixels over the tolerance, the largest difference in *worst
+static int compare(const char* name, ClockSprite& fb, int* worst) {
+    const Frame& frame = golden[name];
+    const uint16_t* px = (const uint16_t*)fb.getPointer();
+    int bad = 0;
+    *worst = 0;
+    for (size_t i = 0; i < frame.px.size(); i++) {
+        int d = difference(px[i], frame.px[i]);
+        if (d > *worst) *worst = d;
+        if (d > TOLERANCE) bad++;
+    }
+    return bad;
+}
+
+static void test_golden_frames() {
+    readGolden();
+    bool failed = false;
+    char name[64];
+    for (uint8_t i = 0; i < GOLDEN_TIMES; i++) {
+        for (uint8_t f = 0; f < GOLDEN_FACES; f++) {
+            GoldenFace which = (GoldenFace)f;
+            snprintf(name, sizeof(name), "%s-%s", goldenFaceName(which), golden_times[i].name);
+            drawGoldenFrame(face, hours, minutes, which, golden_times[i].t);
+            if (!golden.count(name) || golden[name].w != face.width() || golden[name].h != face.height()) {
+                printf("%-28s no golden frame of this size\n", name);
+                failed = true;
+                continue;
+            }
+            int worst;
+            int bad = compare(name, face, &worst);
+            printf("%-28s %6d pixels off, max difference %d\n", name, bad, worst);
+            if (bad) failed = true;
+        }
+    }
+    if (failed) {
+        mkdir("golden_diff", 0777);
+        FILE* f = fopen(DIFF, "wb");
+        if (f) {
+            FilePrint out(f);
+            for (uint8_t i = 0; i < GOLDEN_TIMES; i++) {
+                for (uint8_t g = 0; g < GOLDEN_FACES; g++) {
+                    drawGoldenFrame(face, hours, minutes, (GoldenFace)g, golden_times[i].t);
+                    dumpFrame(out, goldenFaceName((GoldenFace)g), golden_times[i].name, face);
+                }
+            }
+            fclose(f);
+        }
+        TEST_FAIL_MESSAGE("faces differ from the golden frames, see golden_diff/faces.bin");
+    }
+}
+
+// a frame from the dial cache is the same as one drawn from scratch
+static void test_dial_cache() {
+    const day_us_t t = golden_times[GOLDEN_TIMES - 1].t;
+    std::vector<uint16_t> cold(SCREEN_W * SCREEN_H);
+    face.clearDial();
+    drawGoldenFrame(face, hours, minutes, GOLDEN_ANALOG, t);
+    memcpy(cold.data(), face.getPointer(), cold.size() * 2);
+    drawGoldenFrame(face, hours, minutes, GOLDEN_ANALOG, t);
+    TEST_ASSERT_EQUAL_MESSAGE(0, memcmp(cold.data(), face.getPointer(), cold.size() * 2), "warm dial");
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+    // set up like setupDisplays(), the golden backgrounds stand in for the panels'
+    for (uint16_t fg : aa_colors) {
+        blend_lut.registerPair(fg, TFT_DARKGREEN);
+        blend_lut.registerPair(fg, TFT_BLUE);
+    }
+    face.createSprite(SCREEN_W, SCREEN_H);
+    face.loadFont("Futura-MediumItalic-18");
+    face.setKnownBackground(true);
+    face.setBlendLut(&blend_lut);
+    minutes.createSprite(SCREEN_W / 2, SCREEN_H / 2);
+    minutes.loadFont("Mali-Bold-60");
+    minutes.setKnownBackground(true);
+    hours.createSprite(SCREEN_W / 2, SCREEN_H / 2);
+    hours.loadFont("Mali-Bold-90");
+    hours.setKnownBackground(true);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_golden_frames);
+    RUN_TEST(test_dial_cache);
+    return UNITY_END();
+}
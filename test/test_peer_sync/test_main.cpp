@@ -0,0 +1,112 @@
+// PeerSync and ClockDiscipline on the host, several clocks over loopback:
+//     pio test -e native
+// Each clock runs in a thread of its own, with a system clock of its own
+// (test/host/HostClock.h) that starts tens of milliseconds off and gains
+// or loses tens of ppm. One of them is set by "NTP". The others have to
+// find it from the beacons, follow it to well under a millisecond, and
+// when it goes away agree on the next leader and stay together.
+#include <unity.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <thread>
+#include "PeerSync.h"
+
+static const uint8_t UNITS = 4;
+static const int64_t CLOSE_US = 1000;
+
+struct Unit {
+    uint32_t id;
+    int64_t offset_us;        // how far off the clock starts
+    double rate_ppm;
+    bool ntp;                 // set by NTP, leads
+    ClockDiscipline clock;
+    PeerSync peer{&clock};
+    std::atomic<bool> running{false};
+    std::atomic<int64_t> error_us{0};   // system clock minus the host's
+    std::thread thread;
+};
+
+static Unit units[UNITS];
+
+static void run(Unit* unit) {
+    host_clock.offset_us = unit->offset_us;
+    host_clock.rate_ppm = unit->rate_ppm;
+    if (unit->ntp) unit->clock.correct(-unit->offset_us, ClockDiscipline::SOURCE_NTP);
+    while (unit->running) {
+        unit->peer.service(100);
+        unit->clock.tick();
+        unit->error_us = host_clock.offset_us + (int64_t)(hostElapsedUs() * host_clock.rate_ppm / 1e6);
+    }
+}
+
+static void startUnit(Unit& unit) {
+    unit.running = true;
+    unit.thread = std::thread(run, &unit);
+}
+
+static void stopUnit(Unit& unit) {
+    unit.running = false;
+    unit.thread.join();
+}
+
+// the clocks still running, against the first of them
+static void checkTogether(uint8_t from, int64_t within_us) {
+    char what[64];
+    int64_t spread = 0;
+    for (uint8_t i = from + 1; i < UNITS; i++) spread = max(spread, (int64_t)llabs(units[i].error_us - units[from].error_us));
+    snprintf(what, sizeof(what), "within %lld us of unit %u", (long long)spread, units[from].id);
+    TEST_MESSAGE(what);
+    for (uint8_t i = from + 1; i < UNITS; i++) {
+        snprintf(what, sizeof(what), "unit %u against unit %u", units[i].id, units[from].id);
+        TEST_ASSERT_INT32_WITHIN_MESSAGE(within_us, units[from].error_us.load(), units[i].error_us.load(), what);
+    }
+}
+
+static void test_follow_leader() {
+    // a few beacons to find the leader, then the first measurement steps the clocks
+    delay(3 * PeerSync::BEACON_MS);
+    for (Unit& unit : units) TEST_ASSERT_EQUAL_UINT32_MESSAGE(units[0].id, unit.peer.stats().leader, "leader");
+    // NTP set the leader right
+    TEST_ASSERT_INT32_WITHIN_MESSAGE(CLOSE_US, 0, units[0].error_us.load(), "leader");
+    checkTogether(0, CLOSE_US);
+    // and they stay together through the next measurement, drifting apart in between
+    delay(PeerSync::POLL_MS + PeerSync::BEACON_MS);
+    checkTogether(0, CLOSE_US);
+    for (uint8_t i = 1; i < UNITS; i++) TEST_ASSERT_EQUAL_UINT32_MESSAGE(UNITS - 1, units[i].peer.stats().peers, "peers");
+}
+
+static void test_handover() {
+    stopUnit(units[0]);
+    delay(PeerSync::LOST_MS + 3 * PeerSync::BEACON_MS);
+    // none of the others has NTP, the lowest id takes over
+    for (uint8_t i = 1; i < UNITS; i++) TEST_ASSERT_EQUAL_UINT32_MESSAGE(units[1].id, units[i].peer.stats().leader, "new leader");
+    TEST_ASSERT_TRUE(units[1].peer.leading());
+    checkTogether(1, CLOSE_US);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+    const int64_t offsets[UNITS] = {-30000, 45000, -70000, 20000};
+    const double rates[UNITS] = {20, -30, 25, 30};
+    for (uint8_t i = 0; i < UNITS; i++) {
+        Unit& unit = units[i];
+        unit.id = 0x100 + i;
+        unit.offset_us = offsets[i];
+        unit.rate_ppm = rates[i];
+        unit.ntp = i == 0;
+        if (!unit.peer.begin(unit.id, inet_addr("127.0.0.1"))) {
+            printf("no multicast over loopback here\n");
+            return 1;
+        }
+    }
+    for (Unit& unit : units) startUnit(unit);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_follow_leader);
+    RUN_TEST(test_handover);
+    int failures = UNITY_END();
+    for (uint8_t i = 1; i < UNITS; i++) stopUnit(units[i]);
+    return failures;
+}
@@ -0,0 +1,124 @@
+// The pixel heatmap of the faces, drawn on the host:
+//     pio test -e native
+// The same frames a -D PIXEL_HEATMAP build dumps at boot: the analog face
+// with the dial cache cold and warm, and the digital minutes. They are
+// written to heatmap/faces.bin for tools/heatmap.py:
+//     python tools/heatmap.py heatmap/faces.bin --ppm heatmap
+// and checked for what the dial cache and the primitives promise: every
+// pixel is filled once, the warm frame draws no numerals, and the hands
+// cost the same either way.
+#include <unity.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include "Faces.h"
+
+static const day_us_t T = 10 * US_PER_HOUR + 8 * US_PER_MIN + 42500000;
+
+static TFT_eSPI tft;
+static ClockSprite face(&tft);
+static ClockSprite minutes(&tft);
+static BlendLut blend_lut;
+static PixelHeat heat;
+static FILE* out_file;
+
+class FilePrint : public Print {
+public:
+    size_t write(uint8_t c) override { return out_file ? fwrite(&c, 1, 1, out_file) : 0; }
+    size_t write(const uint8_t* buf, size_t n) override { return out_file ? fwrite(buf, 1, n, out_file) : 0; }
+};
+static FilePrint out;
+
+// pixels of the frame written or blended at least once
+static uint32_t touched() {
+    uint32_t count = 0;
+    for (int32_t y = 0; y < face.height(); y++) {
+        for (int32_t x = 0; x < face.width(); x++) {
+            if (heat.writesAt(x, y) || heat.blendsAt(x, y)) count++;
+        }
+    }
+    return count;
+}
+
+static uint32_t total(uint32_t (PixelHeat::*count)(PixelHeat::Primitive) const) {
+    uint32_t sum = 0;
+    for (uint8_t p = 0; p < PixelHeat::PRIMITIVES; p++) sum += (heat.*count)((PixelHeat::Primitive)p);
+    return sum;
+}
+
+static void test_analog() {
+    const uint32_t pixels = SCREEN_W * SCREEN_H;
+    TEST_ASSERT_TRUE(heat.begin(face.width(), face.height()));
+    face.setHeatmap(&heat);
+
+    face.clearDial();
+    drawAnalogFace(face, T, TFT_DARKGREEN);
+    heat.dump(out, "analog-cold");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(pixels, touched(), "cold, every pixel");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(pixels, heat.writeTotal(PixelHeat::FILL), "cold, one fill");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(12, heat.calls(PixelHeat::TEXT), "cold, the numerals");
+    uint32_t cold_writes = total(&PixelHeat::writeTotal);
+    uint32_t cold_blends = total(&PixelHeat::blendTotal);
+    uint32_t line_writes = heat.writeTotal(PixelHeat::LINE);
+    uint32_t line_blends = heat.blendTotal(PixelHeat::LINE);
+    TEST_ASSERT_TRUE_MESSAGE(line_blends > 0, "the hands have anti-aliased edges");
+
+    heat.reset();
+    drawAnalogFace(face, T, TFT_DARKGREEN);
+    heat.dump(out, "analog-warm");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(pixels, touched(), "warm, every pixel");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(pixels, heat.writeTotal(PixelHeat::DIAL), "warm, the dial copied in");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, heat.calls(PixelHeat::FILL), "warm, no fill");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, heat.calls(PixelHeat::TEXT), "warm, no numerals");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(line_writes, heat.writeTotal(PixelHeat::LINE), "warm, the same hands");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(line_blends, heat.blendTotal(PixelHeat::LINE), "warm, the same hands");
+    // the numerals aren't drawn again
+    TEST_ASSERT_TRUE_MESSAGE(total(&PixelHeat::writeTotal) <= cold_writes, "warm writes no more");
+    TEST_ASSERT_TRUE_MESSAGE(total(&PixelHeat::blendTotal) <= cold_blends, "warm blends no more");
+
+    char what[96];
+    snprintf(what, sizeof(what), "cold %u writes %u blends, warm %u writes %u blends", (unsigned)cold_writes,
+             (unsigned)cold_blends, (unsigned)total(&PixelHeat::writeTotal), (unsigned)total(&PixelHeat::blendTotal));
+    TEST_MESSAGE(what);
+    face.setHeatmap(nullptr);
+}
+
+static void test_digital_minutes() {
+    uint32_t pixels = minutes.width() * minutes.height();
+    TEST_ASSERT_TRUE(heat.begin(minutes.width(), minutes.height()));
+    minutes.setHeatmap(&heat);
+    drawDigitalMinutes(minutes, T, TFT_BLUE);
+    heat.dump(out, "digital-minutes");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(pixels, heat.writeTotal(PixelHeat::FILL), "one fill");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(2, heat.calls(PixelHeat::TEXT), "minutes and seconds");
+    // known background text is stored from the ramp, not blended
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, heat.blendTotal(PixelHeat::TEXT), "no text blends");
+    minutes.setHeatmap(nullptr);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+    // set up like setupDisplays()
+    for (uint16_t fg : aa_colors) blend_lut.registerPair(fg, TFT_DARKGREEN);
+    face.createSprite(SCREEN_W, SCREEN_H);
+    face.loadFont("Futura-MediumItalic-18");
+    face.setKnownBackground(true);
+    face.setBlendLut(&blend_lut);
+    minutes.createSprite(SCREEN_W / 2, SCREEN_H / 2);
+    minutes.loadFont("Mali-Bold-60");
+    minutes.setKnownBackground(true);
+
+    mkdir("heatmap", 0777);
+    out_file = fopen("heatmap/faces.bin", "wb");
+
+    UNITY_BEGIN();
+    RUN_TEST(test_analog);
+    RUN_TEST(test_digital_minutes);
+    int failures = UNITY_END();
+    if (out_file) {
+        fputs("\nHEATMAP_END\n", out_file);
+        fclose(out_file);
+    }
+    return failures;
+}
@@ -0,0 +1,115 @@
+// TimeZone against glibc's localtime_r(), on the host:
+//     pio test -e native
+// Every zone is walked from 2000 to 2025 in 15 minute steps, and each
+// change of offset glibc reports is found to the second and checked on
+// both sides. The rule-less US default isn't compared, TimeZone follows
+// newlib there (see TimeZone.h), glibc reads it differently.
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "TimeZone.h"
+
+static const char* const zones[] = {
+    "CET-1CEST,M3.5.0,M10.5.0/3",               // Zurich
+    "GMT0BST,M3.5.0/1,M10.5.0",                 // London
+    "EST5EDT,M3.2.0,M11.1.0",                   // New York
+    "PST8PDT,M3.2.0,M11.1.0",                   // Los Angeles
+    "NST3:30NDT,M3.2.0,M11.1.0",                // St. John's, half hours
+    "AEST-10AEDT,M10.1.0,M4.1.0/3",             // Sydney, DST over new year
+    "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",     // Lord Howe, half hour of DST
+    "<-02>2<-01>,M3.5.0/-1,M10.5.0/0",          // Nuuk, negative rule time
+    "IST-5:30",                                 // Kolkata, no DST
+    "<+0545>-5:45",                             // Kathmandu
+};
+
+static const time_t FROM = 946684800;       // 2000-01-01
+static const time_t UNTIL = 1767225600;     // 2026-01-01
+static const time_t STEP = 900;
+
+static struct tm glibcTime(time_t utc) {
+    struct tm tm;
+    localtime_r(&utc, &tm);
+    return tm;
+}
+
+static void check(TimeZone& zone, const char* posix, time_t utc) {
+    struct tm tm = glibcTime(utc);
+    bool dst;
+    int32_t offset = zone.offset(utc, &dst);
+    int32_t secs = zone.daySeconds(utc);
+    char where[96];
+    snprintf(where, sizeof(where), "%s at %lld", posix, (long long)utc);
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(tm.tm_gmtoff, offset, where);
+    TEST_ASSERT_EQUAL_MESSAGE(tm.tm_isdst > 0, dst, where);
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec, secs, where);
+}
+
+// the first second of the new offset, somewhere in (from, until]
+static time_t findChange(time_t from, time_t until) {
+    long before = glibcTime(from).tm_gmtoff;
+    while (until - from > 1) {
+        time_t mid = from + (until - from) / 2;
+        if (glibcTime(mid).tm_gmtoff == before) from = mid;
+        else until = mid;
+    }
+    return until;
+}
+
+static void compareZone(const char* posix) {
+    TimeZone zone;
+    TEST_ASSERT_TRUE_MESSAGE(zone.parse(posix), posix);
+    setenv("TZ", posix, 1);
+    tzset();
+
+    int changes = 0;
+    long last = glibcTime(FROM).tm_gmtoff;
+    for (time_t utc = FROM; utc < UNTIL; utc += STEP) {
+        long now = glibcTime(utc).tm_gmtoff;
+        if (now != last) {
+            time_t change = findChange(utc - STEP, utc);
+            check(zone, posix, change - 1);
+            check(zone, posix, change);
+            changes++;
+            last = now;
+        }
+        check(zone, posix, utc);
+    }
+    // a zone with rules changes twice a year
+    bool rules = zone.offset(FROM) != zone.offset(FROM + 182 * 86400);
+    if (rules) TEST_ASSERT_EQUAL_MESSAGE(52, changes, posix);
+}
+
+// lookups going back in time recompute the cache too
+static void test_backwards() {
+    const char* posix = zones[0];
+    TimeZone zone;
+    zone.parse(posix);
+    setenv("TZ", posix, 1);
+    tzset();
+    for (time_t utc = UNTIL; utc > FROM; utc -= 7 * 86400 + 3600) check(zone, posix, utc);
+}
+
+static void test_bad_strings() {
+    TimeZone zone;
+    zone.parse("IST-5:30");
+    const char* bad[] = {"", "C", "CET", "CET-1CEST,M3.5", "CET-1CEST,M13.5.0,M10.5.0", "CET-1CEST,M3.5.0,M10.5.0x"};
+    for (const char* posix : bad) TEST_ASSERT_FALSE_MESSAGE(zone.parse(posix), posix);
+    // a bad string leaves the zone as it was
+    TEST_ASSERT_EQUAL_INT32(5 * 3600 + 1800, zone.offset(FROM));
+}
+
+static void test_zones() {
+    for (const char* posix : zones) compareZone(posix);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_zones);
+    RUN_TEST(test_backwards);
+    RUN_TEST(test_bad_strings);
+    return UNITY_END();
+}
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""How many panels at what frame rate: a timing model of the panel SPI buses.
+
+A layout is a list of panels, each FACE[:bus=N][:mirror]:
+    python tools/fps_planner.py analog digital:bus=1
+    python tools/fps_planner.py analog analog:mirror analog:mirror --clock 40e6 --no-dma
+
+Faces push what the firmware pushes:
+    analog, span   the 240x240 face sprite: on bus 0 the full frame over DMA, or
+                   without DMA the inscribed circle a row at a time from the CPU
+                   (PUSH_CIRCLE); bus 1 always sends the full frame over DMA
+    digital        the 120x120 minutes sprite, once a second
+    traceN         panel N of an SPI trace given with --trace (see spi_trace.py),
+                   the traffic the real face code produced on the board
+
+The loop is simulated the way main.cpp runs it: groups are rendered one after
+the other, each bus sends in its own task, and a face can't be redrawn until
+its bus has sent the last one (one face sprite per bus). Mirrored panels with
+the same face on the same bus share a render and a push.
+
+Render times come from the board: --profile reads the Serial log of a
+-D PROFILER build and takes the mean of the last report's analog, digital and
+span zones, the time from a face's sprite being free to its submit.
+    python tools/fps_planner.py analog digital:bus=1 --profile boot.log
+--render-ms puts in figures of your own, or overrides single faces.
+"""
+import argparse
+import math
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import spi_trace   # noqa: E402
+
+APB_HZ = 80e6               # ESP32 SPI clock is APB / n
+WINDOW_BYTES = spi_trace.WINDOW_BYTES
+WINDOW_TRANSACTIONS = 5     # CASET, its data, RASET, its data, RAMWR
+
+RENDER_ZONES = ("analog", "digital", "span")
+PROFILE_LINE = re.compile(r"PROFILE (\S+)\s+(\d+)\s+([\d.]+)")
+
+
+def profile_ms(log):
+    """mean ms per face zone, from the last report in a PROFILER build's log"""
+    render_ms = {}
+    for line in log.splitlines():
+        m = PROFILE_LINE.match(line)
+        if m and m.group(1) in RENDER_ZONES:
+            render_ms[m.group(1)] = float(m.group(3)) / 1000.0
+    return render_ms
+
+
+class Workload:
+    """One push of a face: address windows, pixels and CS selections"""
+    def __init__(self, windows, pixels, pushes=1, per_second=False, cpu=False):
+        self.windows = windows
+        self.pixels = pixels
+        self.pushes = pushes
+        self.per_second = per_second    # pushed once a second, not every frame
+        self.cpu = cpu                  # the CPU feeds the pixels even with DMA up
+
+
+def circle_workload(size):
+    """PUSH_CIRCLE: one window per row spanning the circle plus an AA pixel,
+    same as ClockSprite::circleSpan()"""
+    r = size / 2.0
+    windows = pixels = 0
+    for row in range(size):
+        dy = row + 0.5 - r
+        if abs(dy) >= r:
+            continue
+        half = math.sqrt(r * r - dy * dy) + 1.0
+        x0 = max(math.floor(r - half), 0)
+        x1 = min(math.ceil(r + half), size)
+        windows += 1
+        pixels += x1 - x0
+    return Workload(windows, pixels, cpu=True)
+
+
+def face_workload(face, bus, trace):
+    if face in ("analog", "span"):
+        # ClockSprite::pushCircle() sends the full frame when DMA is up,
+        # SpiPanelBus always does
+        if bus.dma:
+            return Workload(1, 240 * 240)
+        return circle_workload(240)
+    if face == "digital":
+        return Workload(1, 120 * 120, per_second=True)
+    if face.startswith("trace"):
+        if trace is None:
+            sys.exit("%s needs --trace" % face)
+        panel = int(face[5:])
+        st = trace.stats.get(panel)
+        frames = len([f for f in trace.frames if f.index >= 0]) or 1
+        if st is None:
+            sys.exit("panel %d isn't in the trace (has %s)" % (panel, sorted(trace.stats)))
+        # a trace frame holds every push the panel got in it
+        return Workload(st.windows / frames, st.pixels / frames, st.pushes / frames)
+    sys.exit("unknown face %r" % face)
+
+
+class Bus:
+    def __init__(self, args, dma):
+        want = args.clock
+        self.hz = min(APB_HZ / math.ceil(APB_HZ / want), args.max_clock)
+        self.want = want
+        self.dma = dma
+        self.txn_us = args.txn_us
+        self.cs_us = args.cs_us
+        self.cpu_bps = args.cpu_mbps * 1e6
+
+    def push_ms(self, w):
+        """Bus time for one push, in ms"""
+        byte_us = 8e6 / self.hz
+        window_us = w.windows * (WINDOW_BYTES * byte_us + WINDOW_TRANSACTIONS * self.txn_us)
+        pixel_bytes = 2 * w.pixels
+        pixel_us = pixel_bytes * byte_us
+        if w.cpu or not self.dma:
+            # the CPU refills the 64 byte FIFO, whichever is slower wins
+            pixel_us = max(pixel_us, pixel_bytes / self.cpu_bps * 1e6)
+        pixel_us += w.windows * self.txn_us
+        cs_us = w.pushes * 2 * self.cs_us    # select and release
+        return (window_us + pixel_us + cs_us) / 1000.0
+
+
+class Group:
+    def __init__(self, face, bus, mirror, workload, render_ms):
+        self.face = face
+        self.mirror = mirror
+        self.bus = bus
+        self.workload = workload
+        self.render_ms = render_ms
+        self.panels = []
+        self.frames = 0
+
+
+def parse_layout(specs, buses, trace, render_ms):
+    groups = []
+    panels = []
+    for i, spec in enumerate(specs):
+        parts = spec.split(":")
+        face, bus, mirror = parts[0], 0, False
+        for opt in parts[1:]:
+            if opt == "mirror":
+                mirror = True
+            elif opt.startswith("bus="):
+                bus = int(opt[4:])
+            else:
+                sys.exit("bad panel option %r in %r" % (opt, spec))
+        if bus not in (0, 1):
+            sys.exit("the ESP32 has two panel buses, 0 and 1")
+        group = None
+        if mirror:
+            group = next((g for g in groups if g.mirror and g.face == face and g.bus == bus), None)
+        if group is None:
+            # a traced face is timed like the analog one
+            ms = render_ms.get(face, render_ms.get("analog") if face.startswith("trace") else None)
+            if ms is None:
+                sys.exit("no render time for %s: give --profile with a PROFILER log, or --render-ms %s=MS" % (face, face))
+            group = Group(face, bus, mirror, face_workload(face, buses[bus], trace), ms)
+            groups.append(group)
+        group.panels.append(i)
+        panels.append((i, face, bus, group))
+    return groups, panels
+
+
+def simulate(groups, buses, seconds):
+    """Run the loop for a while. Returns ms per loop, and per bus the share
+    of time it was sending and the share the loop spent waiting for it, and
+    the share spent rendering."""
+    t = 0.0
+    bus_free = {0: 0.0, 1: 0.0}
+    bus_busy = {0: 0.0, 1: 0.0}
+    waited = {0: 0.0, 1: 0.0}
+    rendering = 0.0
+    next_second = 0.0
+    loops = 0
+    while t < seconds * 1000.0:
+        new_second = t >= next_second
+        if new_second:
+            next_second += 1000.0
+        for g in groups:
+            if g.workload.per_second and not new_second:
+                continue
+            if bus_free[g.bus] > t:          # wait for this bus's sprite
+                waited[g.bus] += bus_free[g.bus] - t
+                t = bus_free[g.bus]
+            t += g.render_ms
+            rendering += g.render_ms
+            push = buses[g.bus].push_ms(g.workload)
+            start = max(t, bus_free[g.bus])
+            bus_free[g.bus] = start + push
+            bus_busy[g.bus] += push
+            g.frames += 1
+        if not any(not g.workload.per_second for g in groups):
+            t = max(t, next_second)          # nothing animates, sleep to the next second
+        t += 0.05                            # loop overhead
+        loops += 1
+    return t / loops, {b: bus_busy[b] / t for b in bus_busy}, {b: waited[b] / t for b in waited}, rendering / t, t
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("panels", nargs="+", help="FACE[:bus=N][:mirror] per panel")
+    ap.add_argument("--clock", type=float, default=160e6, help="SPI_FREQUENCY asked for (Hz)")
+    ap.add_argument("--max-clock", type=float, default=80e6,
+                    help="fastest the pins and panel manage, 80 MHz on IOMUX pins, 26.7 MHz through the GPIO matrix")
+    ap.add_argument("--dma", action=argparse.BooleanOptionalAction, default=True,
+                    help="TFT_eSPI sends bus 0 pixels by DMA, bus 1 always uses it")
+    ap.add_argument("--txn-us", type=float, default=1.5, help="set-up per SPI transaction (us)")
+    ap.add_argument("--cs-us", type=float, default=0.3, help="per CS change (us)")
+    ap.add_argument("--cpu-mbps", type=float, default=12.0, help="how fast the CPU feeds the FIFO without DMA (MB/s)")
+    ap.add_argument("--profile", help="Serial log of a -D PROFILER build, for the render times")
+    ap.add_argument("--render-ms", default="", help="render time per face, e.g. analog=5.5,digital=3")
+    ap.add_argument("--trace", help="SPI trace for traceN faces")
+    ap.add_argument("--seconds", type=float, default=10.0, help="how long to simulate")
+    args = ap.parse_args()
+
+    render_ms = {}
+    if args.profile:
+        with open(args.profile, errors="replace") as f:
+            render_ms = profile_ms(f.read())
+        if not render_ms:
+            sys.exit("no PROFILE report in %s" % args.profile)
+    for item in filter(None, args.render_ms.split(",")):
+        face, ms = item.split("=")
+        render_ms[face] = float(ms)
+
+    trace = None
+    if args.trace:
+        with open(args.trace, "rb") as f:
+            trace = spi_trace.replay(spi_trace.extract(f.read()))
+
+    bus = Bus(args, args.dma)
+    buses = {0: bus, 1: Bus(args, True)}
+    groups, panels = parse_layout(args.panels, buses, trace, render_ms)
+    loop_ms, busy, waited, rendering, total_ms = simulate(groups, buses, args.seconds)
+
+    print("SPI %.1f MHz (asked %.1f MHz), DMA on bus 0 %s" % (bus.hz / 1e6, bus.want / 1e6, "on" if bus.dma else "off"))
+    print("%5s %-8s %3s %5s %10s %10s %7s" % ("panel", "face", "bus", "group", "push ms", "render ms", "fps"))
+    for i, face, b, g in panels:
+        fps = g.frames / (total_ms / 1000.0)
+        print("%5d %-8s %3d %5d %10.2f %10.2f %7.1f" % (
+            i, face, b, groups.index(g), buses[b].push_ms(g.workload), g.render_ms, fps))
+    used = sorted({g.bus for g in groups})
+    print("loop %.2f ms (%.1f loops/s), rendering %.0f%% of the time" % (loop_ms, 1000.0 / loop_ms, 100 * rendering))
+    for b in used:
+        print("bus %d: sending %.0f%% of the time, loop waiting for it %.0f%%" % (b, 100 * busy[b], 100 * waited[b]))
+    limit = max(used, key=lambda b: waited[b])
+    if waited[limit] > rendering:
+        print("limited by bus %d: a faster clock, fewer panels on it or mirroring would help" % limit)
+    else:
+        print("limited by rendering")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Compare the faces against the golden frames, from a -D GOLDEN_FRAMES build.
+
+That build draws the analog and digital faces at fixed times (midnight,
+12:59:59, both DST edges, fractional seconds...) at boot and dumps them to
+Serial. The golden frames are test/test_faces/golden.bin, a dump in the same
+format, which the host test (pio test -e native) checks too. Check a board:
+    python tools/golden_frames.py --port /dev/ttyUSB0
+A saved raw Serial log works in place of --port, so does the
+golden_diff/faces.bin the host test writes when a frame is off.
+
+A pixel matches when no colour channel (8 bit) is off by more than
+--tolerance, one 5 bit step by default: the ESP32 and the host round the
+float edge distances a little differently. Frames that don't match get a
+diff image: matching pixels are dimmed grey, differences red. Only once the
+differences are the ones a change meant to make, store the new frames:
+    python tools/golden_frames.py golden_diff/faces.bin --update
+"""
+import argparse
+import array
+import os
+import re
+import struct
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+GOLDEN = os.path.join(HERE, "..", "test", "test_faces", "golden.bin")
+HEADER = re.compile(rb"GOLDEN (\S+) (\d+) (\d+) (\d+)\n")
+
+
+def parse(raw):
+    """name -> (width, height, panel order pixels)"""
+    frames = {}
+    pos = 0
+    while True:
+        m = HEADER.search(raw, pos)
+        if not m:
+            break
+        name = m.group(1).decode()
+        w, h, size = int(m.group(2)), int(m.group(3)), int(m.group(4))
+        data = raw[m.end():m.end() + size]
+        if len(data) < size:
+            sys.exit("%s is cut short" % name)
+        px = array.array("l")
+        for n, color in struct.iter_unpack("<HH", data):
+            px.extend(array.array("l", [color]) * n)
+        if len(px) != w * h:
+            sys.exit("%s has %d pixels, expected %d" % (name, len(px), w * h))
+        frames[name] = (w, h, px)
+        pos = m.end() + size
+    return frames
+
+
+def capture(port, baud):
+    import serial   # pyserial
+    raw = bytearray()
+    with serial.Serial(port, baud, timeout=60) as ser:
+        print("waiting for the golden frames on %s..." % port, file=sys.stderr)
+        while b"GOLDEN_END" not in raw:
+            chunk = ser.read(4096)
+            if not chunk:
+                sys.exit("timed out")
+            raw += chunk
+    return bytes(raw)
+
+
+def to_rgb(px):
+    """panel order RGB565 to 8 bit RGB, the same as write_ppm()"""
+    out = bytearray()
+    for v in px:
+        v = ((v & 0xFF) << 8) | (v >> 8)
+        r, g, b = v >> 11, (v >> 5) & 0x3F, v & 0x1F
+        out += bytes((r * 255 // 31, g * 255 // 63, b * 255 // 31))
+    return out
+
+
+def encode(frames):
+    """frames back to the dump format, as dumpFrame() writes them"""
+    out = bytearray()
+    for name, (w, h, px) in sorted(frames.items()):
+        runs = bytearray()
+        i = 0
+        while i < len(px):
+            n = 1
+            while i + n < len(px) and n < 0xFFFF and px[i + n] == px[i]:
+                n += 1
+            runs += struct.pack("<HH", n, px[i])
+            i += n
+        out += b"\nGOLDEN %s %d %d %d\n" % (name.encode(), w, h, len(runs)) + runs
+    return bytes(out + b"\nGOLDEN_END\n")
+
+
+def compare(rgb, golden, tolerance):
+    """bad pixel count, largest channel difference and the diff image"""
+    bad = 0
+    worst = 0
+    diff = bytearray(len(rgb))
+    for i in range(0, len(rgb), 3):
+        d = max(abs(rgb[i] - golden[i]), abs(rgb[i + 1] - golden[i + 1]), abs(rgb[i + 2] - golden[i + 2]))
+        worst = max(worst, d)
+        if d > tolerance:
+            bad += 1
+            diff[i] = 255
+        else:
+            diff[i] = diff[i + 1] = diff[i + 2] = (golden[i] + golden[i + 1] + golden[i + 2]) // 9
+    return bad, worst, diff
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("log", nargs="?", help="raw Serial log with the dump")
+    ap.add_argument("--port", help="capture from this serial port instead")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--golden", default=os.path.normpath(GOLDEN), help="golden frames, a dump")
+    ap.add_argument("--diff", default="golden_diff", help="where diff images go")
+    ap.add_argument("--tolerance", type=int, default=9, help="allowed difference per channel (0-255)")
+    ap.add_argument("--max-bad", type=int, default=0, help="pixels allowed over the tolerance per frame")
+    ap.add_argument("--update", action="store_true", help="store these frames as the goldens")
+    args = ap.parse_args()
+
+    if args.port:
+        raw = capture(args.port, args.baud)
+    elif args.log:
+        with open(args.log, "rb") as f:
+            raw = f.read()
+    else:
+        ap.error("give a Serial log or --port")
+    frames = parse(raw)
+    if not frames:
+        sys.exit("no golden frames in the dump")
+
+    if args.update:
+        with open(args.golden, "wb") as f:
+            f.write(encode(frames))
+        print("stored %d golden frames in %s" % (len(frames), args.golden))
+        return
+
+    with open(args.golden, "rb") as f:
+        goldens = parse(f.read())
+    failed = 0
+    faces = {}   # face -> (largest difference, frames that differ at all)
+    for name, (w, h, px) in sorted(frames.items()):
+        if name not in goldens:
+            print("%-28s no golden frame" % name)
+            failed += 1
+            continue
+        gw, gh, golden = goldens[name]
+        if (gw, gh) != (w, h):
+            print("%-28s size %dx%d, golden is %dx%d" % (name, w, h, gw, gh))
+            failed += 1
+            continue
+        bad, worst, diff = compare(to_rgb(px), to_rgb(golden), args.tolerance)
+        ok = bad <= args.max_bad
+        face = name.split("-")[0]
+        most, differ = faces.get(face, (0, 0))
+        faces[face] = (max(most, worst), differ + (worst > 0))
+        print("%-28s %s  %6d pixels off, max difference %d" % (name, "ok  " if ok else "FAIL", bad, worst))
+        if not ok:
+            failed += 1
+            os.makedirs(args.diff, exist_ok=True)
+            with open(os.path.join(args.diff, name + ".ppm"), "wb") as f:
+                f.write(b"P6\n%d %d\n255\n" % (w, h))
+                f.write(diff)
+    for face, (most, differ) in sorted(faces.items()):
+        print("%s: max difference %d, %d frames not identical" % (face, most, differ))
+    print("%d of %d frames match" % (len(frames) - failed, len(frames)))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""Overdraw and pixel cost heatmaps, from a -D PIXEL_HEATMAP build.
+
+That build draws the analog face twice at boot (dial cache cold, then warm)
+and the digital minutes once, counting per pixel how often it was written
+and how often blended (anti-aliased edges), and per primitive (fill, dial,
+text, line, circle) the calls and pixel totals. Then it dumps the counts:
+    python tools/heatmap.py --port /dev/ttyUSB0 --ppm heat
+or from a saved raw Serial log:
+    python tools/heatmap.py boot.log --ppm heat
+The host test (pio test -e native) writes the same frames, drawn on the PC:
+    python tools/heatmap.py heatmap/faces.bin --ppm heat
+
+Per frame it prints the table per primitive and how many pixels were
+touched 0, 1, 2... times. --ppm DIR writes writes/blends/total images per
+frame: black never touched, then blue, green, yellow, red as the count
+goes up to --scale.
+"""
+import argparse
+import array
+import os
+import re
+import struct
+import sys
+
+HEADER = re.compile(rb"HEATMAP (\S+) (\d+) (\d+) (\d+) (\S+)\n")
+
+# blend costs a read, a lookup or multiply and a store, roughly
+BLEND_COST = 3
+
+
+class Frame:
+    def __init__(self, name, width, height, writes, blends, primitives, calls, write_total, blend_total):
+        self.name = name
+        self.width = width
+        self.height = height
+        self.writes = writes
+        self.blends = blends
+        self.primitives = primitives
+        self.calls = calls
+        self.write_total = write_total
+        self.blend_total = blend_total
+
+
+def parse(raw):
+    frames = []
+    pos = 0
+    while True:
+        m = HEADER.search(raw, pos)
+        if not m:
+            break
+        name = m.group(1).decode()
+        w, h, size = int(m.group(2)), int(m.group(3)), int(m.group(4))
+        primitives = m.group(5).decode().split(",")
+        data = raw[m.end():m.end() + size]
+        if len(data) < size:
+            sys.exit("%s is cut short" % name)
+        tables = 3 * 4 * len(primitives)
+        counts = array.array("B")
+        for n, v in struct.iter_unpack("<HB", data[:size - tables]):
+            counts.extend(array.array("B", [v]) * n)
+        if len(counts) != 2 * w * h:
+            sys.exit("%s has %d counts, expected %d" % (name, len(counts), 2 * w * h))
+        k = len(primitives)
+        t = struct.unpack("<%dI" % (3 * k), data[size - tables:])
+        frames.append(Frame(name, w, h, counts[:w * h], counts[w * h:], primitives,
+                            t[:k], t[k:2 * k], t[2 * k:]))
+        pos = m.end() + size
+    return frames
+
+
+def capture(port, baud):
+    import serial   # pyserial
+    raw = bytearray()
+    with serial.Serial(port, baud, timeout=60) as ser:
+        print("waiting for the heatmaps on %s..." % port, file=sys.stderr)
+        while b"HEATMAP_END" not in raw:
+            chunk = ser.read(4096)
+            if not chunk:
+                sys.exit("timed out")
+            raw += chunk
+    return bytes(raw)
+
+
+def heat_color(v, scale):
+    """0 black, then blue -> green -> yellow -> red at scale and above"""
+    if v <= 0:
+        return (0, 0, 0)
+    f = min(v / float(scale), 1.0) * 3
+    stops = [(0, 0, 255), (0, 200, 0), (255, 230, 0), (255, 0, 0)]
+    i = min(int(f), 2)
+    a, b = stops[i], stops[i + 1]
+    f -= i
+    return tuple(int(a[c] + (b[c] - a[c]) * f) for c in range(3))
+
+
+def write_heat_ppm(path, counts, width, height, scale):
+    palette = [bytes(heat_color(v, scale)) for v in range(256)]
+    out = bytearray()
+    for v in counts:
+        out += palette[min(v, 255)]
+    with open(path, "wb") as f:
+        f.write(b"P6\n%d %d\n255\n" % (width, height))
+        f.write(out)
+
+
+def report(fr):
+    pixels = fr.width * fr.height
+    total = array.array("B", (min(a + b, 255) for a, b in zip(fr.writes, fr.blends)))
+    writes, blends = sum(fr.write_total), sum(fr.blend_total)
+    print("%s: %dx%d, %d writes, %d blends, %.2f writes and %.2f blends per pixel, cost %.2f per pixel" % (
+        fr.name, fr.width, fr.height, writes, blends, writes / pixels, blends / pixels,
+        (writes + BLEND_COST * blends) / pixels))
+    print("  %-8s %7s %9s %9s %7s" % ("", "calls", "writes", "blends", "cost"))
+    cost_all = writes + BLEND_COST * blends or 1
+    for i, p in enumerate(fr.primitives):
+        if not (fr.calls[i] or fr.write_total[i] or fr.blend_total[i]):
+            continue
+        cost = fr.write_total[i] + BLEND_COST * fr.blend_total[i]
+        print("  %-8s %7d %9d %9d %6.1f%%" % (p, fr.calls[i], fr.write_total[i], fr.blend_total[i],
+                                           100.0 * cost / cost_all))
+    hist = {}
+    for v in total:
+        hist[min(v, 5)] = hist.get(min(v, 5), 0) + 1
+    print("  touched " + ", ".join("%s%s: %.1f%%" % (k, "+" if k == 5 else "x", 100.0 * hist[k] / pixels)
+                                   for k in sorted(hist)))
+    return total
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("log", nargs="?", help="raw Serial log with the dump")
+    ap.add_argument("--port", help="capture from this serial port instead")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--ppm", metavar="DIR", help="write heatmap images here")
+    ap.add_argument("--scale", type=int, default=6, help="count shown as full red")
+    args = ap.parse_args()
+
+    if args.port:
+        raw = capture(args.port, args.baud)
+    elif args.log:
+        with open(args.log, "rb") as f:
+            raw = f.read()
+    else:
+        ap.error("give a Serial log or --port")
+    frames = parse(raw)
+    if not frames:
+        sys.exit("no heatmaps in the dump")
+
+    for fr in frames:
+        total = report(fr)
+        if args.ppm:
+            os.makedirs(args.ppm, exist_ok=True)
+            for kind, counts in (("writes", fr.writes), ("blends", fr.blends), ("total", total)):
+                write_heat_ppm(os.path.join(args.ppm, "%s-%s.ppm" % (fr.name, kind)),
+                               counts, fr.width, fr.height, args.scale)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""NTP servers on LAN ports, with offsets and delays of their own.
+
+Stands in for the public servers to test the NTP client: each server
+answers on a port of its own, off from this machine's clock by its
+--offset and holding replies back by its --delay. Run three, one of them
+a false ticker 300 ms off:
+    python tools/ntp_standin.py --port 12300 --offset 0,0,300 --delay 2,5,2
+and build the firmware against them:
+    -D NTP_SERVERS='"192.168.1.50:12300","192.168.1.50:12301","192.168.1.50:12302"'
+    -D NTP_POLL=32
+
+The NTP line on Serial should settle near 0 us with 2 of 3 servers used.
+This machine's clock is the reference, keep it synced to something good.
+--asymmetry moves delay to the way back (0.5 is even), --jitter adds a
+random delay per request and --drop loses some of them. A client asking
+more than once a second per server is printed, public servers send kiss-
+o'-death replies for that (--kod sends them here too).
+"""
+import argparse
+import random
+import select
+import socket
+import struct
+import sys
+import threading
+import time
+
+NTP_UNIX_DELTA = 2208988800
+PACKET = struct.Struct("!BBbbII4sQQQQ")
+
+
+def ntp_time(t):
+    """seconds since 1970 as 32.32 seconds since 1900, wrapping in 2036"""
+    sec = int(t)
+    frac = int((t - sec) * (1 << 32))
+    return ((sec + NTP_UNIX_DELTA) & 0xFFFFFFFF) << 32 | frac
+
+
+class Server:
+    def __init__(self, port, offset_ms, delay_ms, args):
+        self.port = port
+        self.offset = offset_ms / 1000.0
+        self.delay = delay_ms / 1000.0
+        self.args = args
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind((args.bind, port))
+        self.last = {}      # client address -> time of its last request
+        self.lock = threading.Lock()
+
+    def now(self):
+        return time.time() + self.offset
+
+    def handle(self, data, addr, received):
+        args = self.args
+        if len(data) < 48 or data[0] & 7 != 3:
+            return
+        transmit = data[40:48]
+        delay = self.delay + random.uniform(0, args.jitter / 1000.0)
+        there = delay * (1 - args.asymmetry)
+        back = delay * args.asymmetry
+
+        with self.lock:
+            early = received - self.last.get(addr[0], 0) < 0.9   # some slack for the client timing
+            self.last[addr[0]] = received
+        if early:
+            print("port %d: %s asks more than once a second" % (self.port, addr[0]), file=sys.stderr)
+            if args.kod:
+                reply = PACKET.pack(0xE4, 0, 0, -20, 0, 0, b"RATE", 0, 0, 0, 0)
+                reply = reply[:24] + transmit + reply[32:]
+                self.sock.sendto(reply, addr)
+                return
+        if random.random() < args.drop:
+            return
+
+        # on its way there, then its way back
+        time.sleep(there)
+        t2 = ntp_time(received + there + self.offset)
+        ref = ntp_time(self.now() - 16)
+        reply = PACKET.pack(0x24, args.stratum, 6, -20, 0, 0, b"LOCL", ref, 0, t2, 0)
+        t3 = ntp_time(self.now())
+        reply = reply[:24] + transmit + reply[32:40] + struct.pack("!Q", t3)
+        time.sleep(back)
+        self.sock.sendto(reply, addr)
+        if args.verbose:
+            print("port %d: %s offset %+.1f ms, delay %.1f ms" % (self.port, addr[0], self.offset * 1e3,
+                                                                   delay * 1e3), file=sys.stderr)
+
+
+def per_server(text, count, name):
+    values = [float(v) for v in text.split(",")]
+    if len(values) == 1:
+        values *= count
+    if len(values) != count:
+        sys.exit("--%s needs one value or one per server" % name)
+    return values
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--bind", default="0.0.0.0", help="address to listen on")
+    ap.add_argument("--port", type=int, default=12300, help="first port, the next servers count up")
+    ap.add_argument("--servers", type=int, help="how many, else one per --offset value")
+    ap.add_argument("--offset", default="0", help="ms ahead of this clock, per server, comma separated")
+    ap.add_argument("--delay", default="0", help="ms network delay, per server")
+    ap.add_argument("--asymmetry", type=float, default=0.5, help="part of the delay on the way back")
+    ap.add_argument("--jitter", type=float, default=0.0, help="ms of random extra delay")
+    ap.add_argument("--drop", type=float, default=0.0, help="part of the requests lost")
+    ap.add_argument("--stratum", type=int, default=2)
+    ap.add_argument("--kod", action="store_true", help="kiss-o'-death for requests under a second apart")
+    ap.add_argument("-v", "--verbose", action="store_true", help="print every request")
+    args = ap.parse_args()
+
+    count = args.servers or len(args.offset.split(","))
+    offsets = per_server(args.offset, count, "offset")
+    delays = per_server(args.delay, count, "delay")
+    servers = [Server(args.port + i, offsets[i], delays[i], args) for i in range(count)]
+    for s in servers:
+        print("NTP on %s:%d, %+g ms, %g ms delay" % (args.bind, s.port, s.offset * 1e3, s.delay * 1e3))
+
+    by_sock = {s.sock: s for s in servers}
+    while True:
+        ready, _, _ = select.select(list(by_sock), [], [])
+        for sock in ready:
+            data, addr = sock.recvfrom(512)
+            received = time.time()
+            s = by_sock[sock]
+            # delays sleep, a thread per request keeps the others on time
+            threading.Thread(target=s.handle, args=(data, addr, received), daemon=True).start()
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except KeyboardInterrupt:
+        pass
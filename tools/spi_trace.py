@@ -0,0 +1,264 @@
+#!/usr/bin/env python3
+"""Replay an SPI trace recorded with -D SPI_TRACE=<frames> (see SpiTrace.h).
+
+Capture it straight from the board:
+    python tools/spi_trace.py --port /dev/ttyUSB0 --save trace.bin
+or read a raw Serial log / saved trace:
+    python tools/spi_trace.py trace.bin
+
+The trace is replayed into a framebuffer per panel. Per frame it reports the
+bytes on the wire, address windows, pixels sent, pixels sent that the panel
+already showed (redundant) and CS changes. --ppm DIR writes what each panel
+shows at the end.
+"""
+import argparse
+import array
+import os
+import struct
+import sys
+
+WINDOW_BYTES = 11       # CASET + 4, RASET + 4, RAMWR
+
+
+def extract(raw):
+    """The trace out of a Serial log, or the trace itself."""
+    if raw.startswith(b"SPTR"):
+        return raw
+    start = raw.find(b"SPI_TRACE ")
+    if start < 0:
+        sys.exit("no SPI_TRACE dump found")
+    eol = raw.index(b"\n", start)
+    size = int(raw[start + 10:eol])
+    data = raw[eol + 1:eol + 1 + size]
+    if len(data) < size:
+        sys.exit("trace cut short: %d of %d bytes" % (len(data), size))
+    return data
+
+
+def capture(port, baud):
+    import serial   # pyserial
+    with serial.Serial(port, baud, timeout=60) as ser:
+        print("waiting for the trace on %s..." % port, file=sys.stderr)
+        while True:
+            line = ser.readline()
+            if not line:
+                sys.exit("timed out")
+            if line.startswith(b"SPI_TRACE "):
+                size = int(line[10:])
+                return ser.read(size)
+
+
+class Frame:
+    def __init__(self, index, us):
+        self.index = index
+        self.us = us
+        self.bytes = 0
+        self.windows = 0
+        self.commands = 0
+        self.pixels = 0
+        self.redundant = 0
+        self.selects = 0
+
+
+class PanelStats:
+    """Traffic seen by one panel, broadcasts count for every panel selected"""
+    def __init__(self):
+        self.pushes = 0
+        self.windows = 0
+        self.pixels = 0
+
+
+class Bus:
+    def __init__(self):
+        self.mask = 0
+        self.x0 = self.y0 = self.x1 = self.y1 = 0
+        self.x = self.y = 0
+
+
+class Replay:
+    def __init__(self, width, height):
+        self.width = width
+        self.height = height
+        self.panels = {}
+        self.stats = {}
+        self.buses = {}
+        self.frames = []
+        self.truncated = False
+
+    def panel(self, i):
+        if i not in self.panels:
+            self.panels[i] = array.array("l", [-1]) * (self.width * self.height)
+        return self.panels[i]
+
+    def bus(self, b):
+        return self.buses.setdefault(b, Bus())
+
+    def selected(self, b):
+        mask = self.bus(b).mask
+        return [self.stats.setdefault(i, PanelStats()) for i in range(32) if mask >> i & 1]
+
+    def frame(self):
+        if not self.frames:
+            self.frames.append(Frame(-1, 0))   # traffic before the first marker
+        return self.frames[-1]
+
+    def select(self, b, mask):
+        self.bus(b).mask = mask
+        self.frame().selects += 1
+        for st in self.selected(b):
+            st.pushes += 1
+
+    def window(self, b, x, y, w, h):
+        bus = self.bus(b)
+        bus.x0, bus.y0, bus.x1, bus.y1 = x, y, x + w - 1, y + h - 1
+        bus.x, bus.y = x, y
+        f = self.frame()
+        f.windows += 1
+        f.bytes += WINDOW_BYTES
+        for st in self.selected(b):
+            st.windows += 1
+
+    def command(self, b, cmd, data):
+        f = self.frame()
+        f.commands += 1
+        f.bytes += 1 + len(data)
+
+    def run(self, b, n, color):
+        """n pixels of one colour into the bus's window, on every selected panel"""
+        bus = self.bus(b)
+        f = self.frame()
+        f.pixels += n
+        f.bytes += 2 * n
+        for st in self.selected(b):
+            st.pixels += n
+        fbs = [self.panel(i) for i in range(32) if bus.mask >> i & 1]
+        while n:
+            seg = min(n, bus.x1 - bus.x + 1)
+            inside = 0 <= bus.y < self.height and 0 <= bus.x and bus.x + seg <= self.width
+            if fbs and inside:
+                base = bus.y * self.width + bus.x
+                if len(fbs) == 1:
+                    f.redundant += fbs[0][base:base + seg].count(color)
+                else:
+                    slices = [fb[base:base + seg] for fb in fbs]
+                    f.redundant += sum(1 for px in zip(*slices) if all(v == color for v in px))
+                fill = array.array("l", [color]) * seg
+                for fb in fbs:
+                    fb[base:base + seg] = fill
+            n -= seg
+            bus.x += seg
+            if bus.x > bus.x1:
+                bus.x = bus.x0
+                bus.y = bus.y + 1 if bus.y < bus.y1 else bus.y0
+
+
+def replay(data):
+    if data[:4] != b"SPTR":
+        sys.exit("not an SPI trace")
+    version, width, height, frames = struct.unpack_from("<BHHH", data, 4)
+    if version != 1:
+        sys.exit("unknown trace version %d" % version)
+    r = Replay(width, height)
+    pos = 11
+    while pos < len(data):
+        kind = data[pos:pos + 1]
+        pos += 1
+        if kind == b"F":
+            (us,) = struct.unpack_from("<I", data, pos)
+            pos += 4
+            r.frames.append(Frame(0, us))
+        elif kind == b"S":
+            b, mask = struct.unpack_from("<BI", data, pos)
+            pos += 5
+            r.select(b, mask)
+        elif kind == b"W":
+            b, x, y, w, h = struct.unpack_from("<BHHHH", data, pos)
+            pos += 9
+            r.window(b, x, y, w, h)
+        elif kind == b"C":
+            b, cmd, n = struct.unpack_from("<BBB", data, pos)
+            pos += 3
+            r.command(b, cmd, data[pos:pos + n])
+            pos += n
+        elif kind == b"P":
+            b, count = struct.unpack_from("<BI", data, pos)
+            pos += 5
+            while count:
+                n, color = struct.unpack_from("<HH", data, pos)
+                pos += 4
+                r.run(b, n, color)
+                count -= n
+        elif kind == b"E":
+            r.truncated = data[pos] != 0
+            break
+        else:
+            sys.exit("bad record %r at %d" % (kind, pos - 1))
+    # number the frames from 0, the pre-marker bucket stays -1
+    n = 0
+    for f in r.frames:
+        if f.index != -1:
+            f.index = n
+            n += 1
+    return r
+
+
+def write_ppm(path, fb, width, height):
+    out = bytearray()
+    for v in fb:
+        v = 0 if v < 0 else ((v & 0xFF) << 8) | (v >> 8)    # panel order to RGB565
+        r, g, b = v >> 11, (v >> 5) & 0x3F, v & 0x1F
+        out += bytes((r * 255 // 31, g * 255 // 63, b * 255 // 31))
+    with open(path, "wb") as f:
+        f.write(b"P6\n%d %d\n255\n" % (width, height))
+        f.write(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("trace", nargs="?", help="trace or raw Serial log")
+    ap.add_argument("--port", help="capture from this serial port instead")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--save", help="write the captured trace here")
+    ap.add_argument("--frames", action="store_true", help="print every frame")
+    ap.add_argument("--ppm", metavar="DIR", help="write each panel's final image")
+    args = ap.parse_args()
+
+    if args.port:
+        data = capture(args.port, args.baud)
+    elif args.trace:
+        with open(args.trace, "rb") as f:
+            data = extract(f.read())
+    else:
+        ap.error("give a trace file or --port")
+    if args.save:
+        with open(args.save, "wb") as f:
+            f.write(data)
+
+    r = replay(data)
+    frames = [f for f in r.frames if f.index >= 0]
+    if args.frames:
+        print("%6s %9s %10s %8s %9s %10s %7s" % ("frame", "ms", "bytes", "windows", "pixels", "redundant", "cs"))
+        for i, f in enumerate(frames):
+            nxt = frames[i + 1].us if i + 1 < len(frames) else None
+            ms = "%.2f" % ((nxt - f.us) / 1000.0) if nxt is not None else "-"
+            print("%6d %9s %10d %8d %9d %10d %7d" % (f.index, ms, f.bytes, f.windows, f.pixels, f.redundant, f.selects))
+
+    print("trace: %d bytes, %d frames%s, panels %s" % (len(data), len(frames),
+          " (truncated)" if r.truncated else "", sorted(r.panels)))
+    if frames:
+        n = len(frames)
+        total = lambda k: sum(getattr(f, k) for f in frames)
+        pixels = total("pixels")
+        print("per frame: %.0f bytes, %.1f windows, %.0f pixels, %.0f redundant (%.1f%%), %.1f CS changes" % (
+            total("bytes") / n, total("windows") / n, pixels / n, total("redundant") / n,
+            100.0 * total("redundant") / pixels if pixels else 0, total("selects") / n))
+        print("bytes/frame min %d max %d" % (min(f.bytes for f in frames), max(f.bytes for f in frames)))
+
+    if args.ppm:
+        os.makedirs(args.ppm, exist_ok=True)
+        for i, fb in sorted(r.panels.items()):
+            write_ppm(os.path.join(args.ppm, "panel%d.ppm" % i), fb, r.width, r.height)
+
+
+if __name__ == "__main__":
+    main()
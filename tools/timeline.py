@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""Turn a -D TIMELINE=<events> Serial stream into a Chrome trace.
+
+The firmware streams begin/end events of the profiler zones (frame, time
+fetch, bus waits, renders, pushes, Serial output, NTP) and instant events
+for CS changes and NTP syncs. Capture a few seconds from the board:
+    python tools/timeline.py --port /dev/ttyUSB0 --seconds 10 -o trace.json
+or convert a saved raw Serial log:
+    python tools/timeline.py boot.log -o trace.json
+and open trace.json in chrome://tracing or https://ui.perfetto.dev.
+
+Loop zones show on a track per core, pushes and CS changes on a track per
+bus, NTP on its own. Set a faster baud rate in the firmware if events get
+dropped, the count is printed.
+"""
+import argparse
+import json
+import re
+import struct
+import sys
+import time
+
+CHUNK = re.compile(rb"\nTIMELINE (\d+) (\d+)\n")
+NAMES = re.compile(rb"\nTIMELINE_NAMES ([^\n]*)\n")
+PHASES = {0: "B", 1: "E", 2: "i"}
+EVENT = struct.Struct("<IIBBxx")
+
+
+def parse(raw):
+    """names by id, events as (us, id, phase, core, arg) and dropped count"""
+    names = {}
+    events = []
+    dropped = 0
+    for m in NAMES.finditer(raw):
+        names = dict(enumerate(m.group(1).decode().split(",")))
+    pos = 0
+    while True:
+        m = CHUNK.search(raw, pos)
+        if not m:
+            break
+        n, lost = int(m.group(1)), int(m.group(2))
+        data = raw[m.end():m.end() + n * EVENT.size]
+        if len(data) < n * EVENT.size:
+            break               # cut off at the end of the capture
+        dropped += lost
+        for us, arg, ident, phase in EVENT.iter_unpack(data):
+            events.append((us, ident, phase & 0x7F, phase >> 7, arg))
+        pos = m.end() + len(data)
+    return names, unwrap(events), dropped
+
+
+def unwrap(events):
+    """micros() wraps after 71 minutes, count the wraps"""
+    out = []
+    base = 0
+    last = None
+    for us, ident, phase, core, arg in events:
+        if last is not None and us + base < last - (1 << 31):
+            base += 1 << 32
+        t = us + base
+        last = max(last or t, t)
+        out.append((t, ident, phase, core, arg))
+    return out
+
+
+def capture(port, baud, seconds):
+    import serial   # pyserial
+    raw = bytearray()
+    with serial.Serial(port, baud, timeout=1) as ser:
+        print("capturing %g s from %s..." % (seconds, port), file=sys.stderr)
+        end = time.time() + seconds
+        while time.time() < end:
+            raw += ser.read(4096)
+    return bytes(raw)
+
+
+def track(name, core):
+    """(tid, track name) an event is drawn on"""
+    for prefix in ("push bus ", "select bus "):
+        if name.startswith(prefix):
+            bus = int(name[len(prefix):])
+            return 10 + bus, "bus %d" % bus
+    if name.startswith("ntp"):
+        return 20, "ntp"
+    return core, "core %d" % core
+
+
+def chrome_trace(names, events):
+    out = []
+    tracks = {}
+    t0 = min(e[0] for e in events)
+    for t, ident, phase, core, arg in sorted(events, key=lambda e: e[0]):
+        name = names.get(ident, "event %d" % ident)
+        tid, tname = track(name, core)
+        tracks[tid] = tname
+        ev = {"name": name, "ph": PHASES.get(phase, "i"), "ts": t - t0, "pid": 0, "tid": tid}
+        if phase == 2:
+            ev["s"] = "t"
+            if name.startswith("select"):
+                ev["args"] = {"panels": "0x%x" % arg}
+        out.append(ev)
+    for tid, tname in tracks.items():
+        out.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": tid, "args": {"name": tname}})
+        out.append({"name": "thread_sort_index", "ph": "M", "pid": 0, "tid": tid, "args": {"sort_index": tid}})
+    out.append({"name": "process_name", "ph": "M", "pid": 0, "args": {"name": "clock"}})
+    return {"traceEvents": out, "displayTimeUnit": "ms"}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("log", nargs="?", help="raw Serial log with the stream")
+    ap.add_argument("--port", help="capture from this serial port instead")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--seconds", type=float, default=10.0, help="how long to capture")
+    ap.add_argument("--save", help="write the raw capture here")
+    ap.add_argument("-o", "--output", default="trace.json", help="Chrome trace JSON")
+    args = ap.parse_args()
+
+    if args.port:
+        raw = capture(args.port, args.baud, args.seconds)
+    elif args.log:
+        with open(args.log, "rb") as f:
+            raw = f.read()
+    else:
+        ap.error("give a Serial log or --port")
+    if args.save:
+        with open(args.save, "wb") as f:
+            f.write(raw)
+
+    names, events, dropped = parse(raw)
+    if not events:
+        sys.exit("no timeline events in the capture")
+    if not names:
+        print("no TIMELINE_NAMES line seen, events are shown by id", file=sys.stderr)
+    with open(args.output, "w") as f:
+        json.dump(chrome_trace(names, events), f)
+    span = (max(e[0] for e in events) - min(e[0] for e in events)) / 1e6
+    print("%d events over %.2f s, %d dropped, written to %s" % (len(events), span, dropped, args.output))
+
+
+if __name__ == "__main__":
+    main()